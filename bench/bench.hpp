@@ -0,0 +1,35 @@
+#pragma once
+#if !defined(REGLEX_BENCH_H)
+#define REGLEX_BENCH_H
+
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace bench
+{
+// Contents of the sample source, the binary is expected to run from the workspace root
+inline std::string const& test_lox()
+{
+    static std::string const source = [] {
+        std::ifstream file("test.lox");
+        using source_iter = std::istreambuf_iterator<char>;
+        return std::string{source_iter(file), source_iter{}};
+    }();
+    return source;
+}
+
+// Repeats a source until it is at least the requested size
+inline std::string repeat(std::string const& source, std::size_t size)
+{
+    std::string out;
+    out.reserve(size + source.size());
+    while (out.size() < size)
+    {
+        out += source;
+    }
+    return out;
+}
+} // namespace bench
+
+#endif // REGLEX_BENCH_H
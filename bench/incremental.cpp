@@ -0,0 +1,55 @@
+#include <benchmark/benchmark.h>
+
+#include <reglex/incremental.hpp>
+
+#include "src/reglex/lox.hpp"
+#include "tools/corpus.hpp"
+
+namespace
+{
+// About 2MiB and 60k lines of generated code without comments, where nothing stops the sweep back
+// from an edit short of the start of the source but the resync points
+std::string const& comment_free()
+{
+    static std::string const source = [] {
+        auto options = corpus::realistic(1, std::size_t{2} << 20);
+        options.comments = 0;
+        options.lookalikes = 0;
+        return corpus::generate(options);
+    }();
+    return source;
+}
+
+// Re-lexing after typing a character range(0) percent of the way through, with resync points when
+// range(1) is set
+void BM_Relex(benchmark::State& state)
+{
+    auto const& source = comment_free();
+    auto const lexed = reglex::lex<TokenTraits>(source);
+    auto const points = state.range(1) ? reglex::resync_points<TokenTraits>(lexed) : reglex::ResyncPoints{};
+    reglex::Edit edit;
+    edit.offset = source.size() * static_cast<std::size_t>(state.range(0)) / 100;
+    auto const edited = source.substr(0, edit.offset) + "x" + source.substr(edit.offset);
+    edit.inserted = std::string_view(edited).substr(edit.offset, 1);
+    for (auto _ : state)
+    {
+        auto const diff = reglex::relex<TokenTraits>(lexed, edited, edit, points);
+        benchmark::DoNotOptimize(diff.inserted.data());
+    }
+}
+
+void BM_ResyncPoints(benchmark::State& state)
+{
+    auto const& source = comment_free();
+    auto const lexed = reglex::lex<TokenTraits>(source);
+    for (auto _ : state)
+    {
+        auto const points = reglex::resync_points<TokenTraits>(lexed);
+        benchmark::DoNotOptimize(points.offsets.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * source.size()));
+}
+} // namespace
+
+BENCHMARK(BM_Relex)->ArgsProduct({{10, 50, 99}, {0, 1}})->ArgNames({"at%", "resync"})->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ResyncPoints)->Unit(benchmark::kMillisecond);
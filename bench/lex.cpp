@@ -0,0 +1,94 @@
+#include <benchmark/benchmark.h>
+
+#include "bench/bench.hpp"
+#include "src/reglex/lox.hpp"
+#include "tools/corpus.hpp"
+
+namespace
+{
+void report(benchmark::State& state, std::size_t bytes, std::size_t tokens)
+{
+    state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+    state.counters["tokens/s"] = benchmark::Counter(static_cast<double>(tokens), benchmark::Counter::kIsRate);
+}
+
+// One token at a time through lex_token, as a hand written parser loop would
+void BM_LexToken(benchmark::State& state)
+{
+    std::string_view const source = bench::test_lox();
+    std::size_t bytes = 0;
+    std::size_t tokens = 0;
+    for (auto _ : state)
+    {
+        auto rest = source;
+        std::size_t line = 0;
+        for (;;)
+        {
+            auto const res = reglex::lex_token<TokenTraits>(rest, line);
+            if (res.status == reglex::Status::NoMatch) break;
+            auto const end = static_cast<std::size_t>(res.token.lexeme.data() - rest.data()) + res.token.lexeme.size();
+            line = res.token.first_line + res.token.num_lines;
+            rest.remove_prefix(end);
+            tokens += res.status == reglex::Status::UnfilteredMatch;
+        }
+        bytes += source.size();
+    }
+    report(state, bytes, tokens);
+}
+
+void BM_LexTestLox(benchmark::State& state)
+{
+    auto const& source = bench::test_lox();
+    std::size_t tokens = 0;
+    for (auto _ : state)
+    {
+        auto const res = reglex::lex<TokenTraits>(source);
+        benchmark::DoNotOptimize(res.tokens.data());
+        tokens += res.tokens.size();
+    }
+    report(state, state.iterations() * source.size(), tokens);
+}
+
+// Generated programs, ordinary ones, ones full of long strings, comment lookalikes and deep
+// nesting, and ones dominated by one kind of token. The seed is fixed so runs are comparable.
+template <corpus::Options (*Preset)(std::uint64_t, std::size_t)>
+void BM_LexCorpus(benchmark::State& state)
+{
+    auto const source = corpus::generate(Preset(1, static_cast<std::size_t>(state.range(0))));
+    std::size_t tokens = 0;
+    for (auto _ : state)
+    {
+        auto const res = reglex::lex<TokenTraits>(source);
+        benchmark::DoNotOptimize(res.tokens.data());
+        tokens += res.tokens.size();
+    }
+    report(state, state.iterations() * source.size(), tokens);
+}
+
+// Lexing throughput alone from 1KiB to 1GiB, tokens are pulled through token_range so that the
+// largest sizes don't need gigabytes of token storage
+void BM_LexScaling(benchmark::State& state)
+{
+    auto const source = bench::repeat(bench::test_lox(), static_cast<std::size_t>(state.range(0)));
+    std::size_t tokens = 0;
+    for (auto _ : state)
+    {
+        for (auto const& tok : reglex::token_range<TokenTraits>(source))
+        {
+            benchmark::DoNotOptimize(tok.type);
+            ++tokens;
+        }
+    }
+    report(state, state.iterations() * source.size(), tokens);
+}
+} // namespace
+
+BENCHMARK(BM_LexToken);
+BENCHMARK(BM_LexTestLox);
+BENCHMARK_TEMPLATE(BM_LexCorpus, corpus::realistic)->Name("BM_LexCorpusRealistic")->Range(1 << 10, 1 << 24);
+BENCHMARK_TEMPLATE(BM_LexCorpus, corpus::adversarial)->Name("BM_LexCorpusAdversarial")->Range(1 << 10, 1 << 24);
+BENCHMARK_TEMPLATE(BM_LexCorpus, corpus::comment_heavy)->Name("BM_LexCommentHeavy")->Range(1 << 10, 1 << 24);
+BENCHMARK_TEMPLATE(BM_LexCorpus, corpus::string_heavy)->Name("BM_LexStringHeavy")->Range(1 << 10, 1 << 24);
+BENCHMARK_TEMPLATE(BM_LexCorpus, corpus::identifier_heavy)->Name("BM_LexIdentifierHeavy")->Range(1 << 10, 1 << 24);
+BENCHMARK_TEMPLATE(BM_LexCorpus, corpus::punctuation_heavy)->Name("BM_LexPunctuationHeavy")->Range(1 << 10, 1 << 24);
+BENCHMARK(BM_LexScaling)->RangeMultiplier(8)->Range(1 << 10, 1 << 30)->Unit(benchmark::kMillisecond);
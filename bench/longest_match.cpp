@@ -0,0 +1,75 @@
+#include <benchmark/benchmark.h>
+#define REGLEX_USE_MACROS
+#include <reglex/dfa.hpp>
+
+#include "bench/bench.hpp"
+#include "src/reglex/lox.hpp"
+
+namespace
+{
+// The Lox grammar with a pattern per keyword, as written for leftmost-first matching before keyword
+// tables. Every keyword carries a lookahead so that it does not match the start of an identifier,
+// and errors consume a whole word.
+struct LeftmostMatcher
+{
+    template <TokenType T>
+    static constexpr std::string_view pattern = Matcher::pattern<T>;
+    template <TokenType T>
+    static constexpr bool filter_out = Matcher::filter_out<T>;
+    template <TokenType>
+    static constexpr std::string_view keyword = "";
+    template <TokenType>
+    static constexpr bool has_keywords = false;
+};
+// clang-format off
+template<> constexpr std::string_view LeftmostMatcher::pattern<TokenType::AND> = REGLEX_KEYWORD("and");
+template<> constexpr std::string_view LeftmostMatcher::pattern<TokenType::STRUCT> = REGLEX_KEYWORD("struct");
+template<> constexpr std::string_view LeftmostMatcher::pattern<TokenType::ELSE> = REGLEX_KEYWORD("else");
+template<> constexpr std::string_view LeftmostMatcher::pattern<TokenType::FUN> = REGLEX_KEYWORD("fun");
+template<> constexpr std::string_view LeftmostMatcher::pattern<TokenType::FOR> = REGLEX_KEYWORD("for");
+template<> constexpr std::string_view LeftmostMatcher::pattern<TokenType::IF> = REGLEX_KEYWORD("if");
+template<> constexpr std::string_view LeftmostMatcher::pattern<TokenType::NIL> = REGLEX_KEYWORD("nil");
+template<> constexpr std::string_view LeftmostMatcher::pattern<TokenType::OR> = REGLEX_KEYWORD("or");
+template<> constexpr std::string_view LeftmostMatcher::pattern<TokenType::PRINT> = REGLEX_KEYWORD("print");
+template<> constexpr std::string_view LeftmostMatcher::pattern<TokenType::RETURN> = REGLEX_KEYWORD("return");
+template<> constexpr std::string_view LeftmostMatcher::pattern<TokenType::SUPER> = REGLEX_KEYWORD("super");
+template<> constexpr std::string_view LeftmostMatcher::pattern<TokenType::THIS> = REGLEX_KEYWORD("this");
+template<> constexpr std::string_view LeftmostMatcher::pattern<TokenType::TRUE> = REGLEX_KEYWORD("true");
+template<> constexpr std::string_view LeftmostMatcher::pattern<TokenType::FALSE> = REGLEX_KEYWORD("false");
+template<> constexpr std::string_view LeftmostMatcher::pattern<TokenType::VAR> = REGLEX_KEYWORD("var");
+template<> constexpr std::string_view LeftmostMatcher::pattern<TokenType::WHILE> = REGLEX_KEYWORD("while");
+template<> constexpr std::string_view LeftmostMatcher::pattern<TokenType::ERROR> = reglex::non_whitespace;
+// clang-format on
+
+using LeftmostTraits = reglex::LexTraits<TokenType, LeftmostMatcher>;
+
+struct LongestTraits : TokenTraits
+{
+    static constexpr bool longest_match = true;
+};
+
+struct DfaTraits : TokenTraits
+{
+    using engine_t = reglex::dfa_engine;
+};
+
+template <typename Traits>
+void BM_LexLox(benchmark::State& state)
+{
+    auto const source = bench::repeat(bench::test_lox(), static_cast<std::size_t>(state.range(0)));
+    std::size_t tokens = 0;
+    for (auto _ : state)
+    {
+        auto const res = reglex::lex<Traits>(source);
+        tokens += res.tokens.size();
+        benchmark::DoNotOptimize(res.tokens.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * source.size()));
+    state.counters["tokens/s"] = benchmark::Counter(static_cast<double>(tokens), benchmark::Counter::kIsRate);
+}
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_LexLox, LeftmostTraits)->Name("LeftmostFirst")->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_LexLox, TokenTraits)->Name("LeftmostFirstKeywordTable")->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_LexLox, LongestTraits)->Name("LongestMatch")->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_LexLox, DfaTraits)->Name("LongestMatchDfa")->Range(1 << 10, 1 << 20);
@@ -0,0 +1,93 @@
+#include <benchmark/benchmark.h>
+#include <reglex/mmap.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include "bench/bench.hpp"
+#include "src/reglex/lox.hpp"
+
+namespace
+{
+// A 128MiB source on disk, written once per run. Reads after the first come from the page cache,
+// so this measures the copy and allocation cost of each loading strategy rather than the disk.
+std::string const& large_file()
+{
+    static std::string const path = [] {
+        auto const p = (std::filesystem::temp_directory_path() / "reglex_bench_128m.lox").string();
+        std::ofstream out(p, std::ios::binary);
+        auto const source = bench::repeat(bench::test_lox(), std::size_t{128} << 20);
+        out.write(source.data(), static_cast<std::streamsize>(source.size()));
+        return p;
+    }();
+    return path;
+}
+
+// The driver's previous loading, a byte at a time through a stream buffer iterator
+void BM_LoadLexIstreambuf(benchmark::State& state)
+{
+    std::size_t bytes = 0;
+    for (auto _ : state)
+    {
+        std::ifstream file(large_file());
+        using source_iter = std::istreambuf_iterator<char>;
+        std::string const source{source_iter(file), source_iter{}};
+        auto const res = reglex::lex<TokenTraits>(source);
+        benchmark::DoNotOptimize(res.tokens.data());
+        bytes += source.size();
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+}
+
+void BM_LoadLexMapped(benchmark::State& state)
+{
+    std::size_t bytes = 0;
+    for (auto _ : state)
+    {
+        reglex::MappedFile const file(large_file());
+        auto const res = reglex::lex<TokenTraits>(file.view());
+        benchmark::DoNotOptimize(res.tokens.data());
+        bytes += file.view().size();
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+}
+
+void BM_LoadIstreambuf(benchmark::State& state)
+{
+    std::size_t bytes = 0;
+    for (auto _ : state)
+    {
+        std::ifstream file(large_file());
+        using source_iter = std::istreambuf_iterator<char>;
+        std::string const source{source_iter(file), source_iter{}};
+        benchmark::DoNotOptimize(source.data());
+        bytes += source.size();
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+}
+
+// Mapping alone is lazy, so touch every page to compare like for like
+void BM_LoadMapped(benchmark::State& state)
+{
+    std::size_t bytes = 0;
+    for (auto _ : state)
+    {
+        reglex::MappedFile const file(large_file());
+        auto const view = file.view();
+        char sum = 0;
+        for (std::size_t i = 0; i < view.size(); i += 4096)
+        {
+            sum = static_cast<char>(sum + view[i]);
+        }
+        benchmark::DoNotOptimize(sum);
+        bytes += view.size();
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+}
+} // namespace
+
+BENCHMARK(BM_LoadLexIstreambuf)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadLexMapped)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadIstreambuf)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadMapped)->Unit(benchmark::kMillisecond);
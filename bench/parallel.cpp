@@ -0,0 +1,22 @@
+#include <benchmark/benchmark.h>
+#include <reglex/parallel.hpp>
+
+#include "bench/bench.hpp"
+#include "src/reglex/lox.hpp"
+
+namespace
+{
+void BM_ParallelLex(benchmark::State& state)
+{
+    static auto const source = bench::repeat(bench::test_lox(), std::size_t{64} << 20);
+    auto const threads = static_cast<std::size_t>(state.range(0));
+    for (auto _ : state)
+    {
+        auto const res = reglex::parallel_lex<TokenTraits>(source, threads);
+        benchmark::DoNotOptimize(res.tokens.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * source.size()));
+}
+} // namespace
+
+BENCHMARK(BM_ParallelLex)->RangeMultiplier(2)->Range(1, 64)->Unit(benchmark::kMillisecond)->UseRealTime();
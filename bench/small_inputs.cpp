@@ -0,0 +1,54 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+
+#include "bench/bench.hpp"
+#include "src/reglex/lox.hpp"
+
+namespace
+{
+// Many small sources lexed one after another, as a request serving path would. Each of these
+// lexes the sample source once per iteration.
+void BM_SnippetLexed(benchmark::State& state)
+{
+    auto const& source = bench::test_lox();
+    for (auto _ : state)
+    {
+        auto const res = reglex::lex<TokenTraits>(source);
+        benchmark::DoNotOptimize(res.tokens.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * source.size()));
+}
+
+void BM_SnippetBuffer(benchmark::State& state)
+{
+    auto const& source = bench::test_lox();
+    std::array<TokenTraits::token_t, 256> buffer;
+    for (auto _ : state)
+    {
+        auto const res = reglex::lex<TokenTraits>(source, buffer.data(), buffer.data() + buffer.size());
+        benchmark::DoNotOptimize(buffer.data());
+        benchmark::DoNotOptimize(res.count);
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * source.size()));
+}
+// Per request arena, everything the result allocated is released by dropping the resource
+void BM_SnippetArena(benchmark::State& state)
+{
+    auto const& source = bench::test_lox();
+    alignas(std::max_align_t) static std::array<std::byte, 1 << 16> arena;
+    for (auto _ : state)
+    {
+        std::pmr::monotonic_buffer_resource resource(arena.data(), arena.size());
+        auto const res = reglex::pmr::lex<TokenTraits>(source, &resource);
+        benchmark::DoNotOptimize(res.tokens.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * source.size()));
+}
+} // namespace
+
+BENCHMARK(BM_SnippetLexed);
+BENCHMARK(BM_SnippetBuffer);
+BENCHMARK(BM_SnippetArena);
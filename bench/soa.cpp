@@ -0,0 +1,76 @@
+#include <benchmark/benchmark.h>
+#include <reglex/soa.hpp>
+
+#include "bench/bench.hpp"
+#include "src/reglex/lox.hpp"
+
+namespace
+{
+void BM_LexAoS(benchmark::State& state)
+{
+    auto const source = bench::repeat(bench::test_lox(), static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state)
+    {
+        auto const res = reglex::lex<TokenTraits>(source);
+        benchmark::DoNotOptimize(res.tokens.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * source.size()));
+}
+
+void BM_LexSoA(benchmark::State& state)
+{
+    auto const source = bench::repeat(bench::test_lox(), static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state)
+    {
+        auto const res = reglex::lex_soa<TokenTraits>(source);
+        benchmark::DoNotOptimize(res.types.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * source.size()));
+}
+
+void BM_ToSoA(benchmark::State& state)
+{
+    auto const source = bench::repeat(bench::test_lox(), static_cast<std::size_t>(state.range(0)));
+    auto const lexed = reglex::lex<TokenTraits>(source);
+    for (auto _ : state)
+    {
+        auto const res = reglex::to_soa(lexed);
+        benchmark::DoNotOptimize(res.types.data());
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * lexed.tokens.size()));
+}
+
+// Finding every identifier, a scan over 40 byte structs against one over a byte array
+void BM_FindIdentifiersAoS(benchmark::State& state)
+{
+    auto const source = bench::repeat(bench::test_lox(), static_cast<std::size_t>(state.range(0)));
+    auto const lexed = reglex::lex<TokenTraits>(source);
+    for (auto _ : state)
+    {
+        std::size_t n = 0;
+        for (auto const& tok : lexed.tokens)
+        {
+            n += tok.type == TokenType::IDENTIFIER;
+        }
+        benchmark::DoNotOptimize(n);
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * lexed.tokens.size()));
+}
+
+void BM_FindIdentifiersSoA(benchmark::State& state)
+{
+    auto const source = bench::repeat(bench::test_lox(), static_cast<std::size_t>(state.range(0)));
+    auto const lexed = reglex::lex_soa<TokenTraits>(source);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(lexed.count(TokenType::IDENTIFIER));
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * lexed.size()));
+}
+} // namespace
+
+BENCHMARK(BM_LexAoS)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_LexSoA)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_ToSoA)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_FindIdentifiersAoS)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_FindIdentifiersSoA)->Range(1 << 10, 1 << 20);
@@ -0,0 +1,232 @@
+#pragma once
+#if !defined(REGLEX_CACHE_H)
+#define REGLEX_CACHE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <reglex/serialize.hpp>
+
+namespace REGLEX_NAMESPACE
+{
+namespace detail
+{
+struct Hash128
+{
+    std::uint64_t low;
+    std::uint64_t high;
+};
+
+constexpr std::uint64_t rotl(std::uint64_t x, int r) noexcept { return (x << r) | (x >> (64 - r)); }
+
+constexpr std::uint64_t fmix(std::uint64_t h) noexcept
+{
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDu;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53u;
+    return h ^ (h >> 33);
+}
+
+// 128 bit hash of a whole source, four independent lanes over 32 byte stripes so it runs at
+// memory speed. Good against accidental collisions, not against crafted ones.
+inline Hash128 content_hash(std::string_view data, std::uint64_t seed) noexcept
+{
+    constexpr std::uint64_t k0 = 0x9E3779B97F4A7C15u;
+    constexpr std::uint64_t k1 = 0xC2B2AE3D27D4EB4Fu;
+    std::uint64_t lanes[4] = {seed ^ k0, seed ^ k1, ~seed ^ k0, ~seed ^ k1};
+    auto const round = [](std::uint64_t h, std::uint64_t v) { return rotl(h ^ v * k1, 31) * k0; };
+    auto const* p = data.data();
+    auto n = data.size();
+    for (; n >= 32; p += 32, n -= 32)
+    {
+        for (std::size_t i = 0; i < 4; ++i)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, p + 8 * i, 8);
+            lanes[i] = round(lanes[i], word);
+        }
+    }
+    // The tail is zero padded, the length below keeps padded inputs apart
+    for (std::size_t i = 0; n > 0; ++i)
+    {
+        std::uint64_t word = 0;
+        auto const take = std::min<std::size_t>(n, 8);
+        std::memcpy(&word, p, take);
+        lanes[i] = round(lanes[i], word);
+        p += take;
+        n -= take;
+    }
+    auto const size = static_cast<std::uint64_t>(data.size());
+    auto const low = fmix(lanes[0] ^ rotl(lanes[1], 17) ^ size);
+    auto const high = fmix(lanes[2] ^ rotl(lanes[3], 29) ^ low);
+    return {low, high};
+}
+} // namespace detail
+
+/// Directory of serialized token streams keyed by what they were lexed from, so unchanged sources
+/// skip lexing. The key hashes the source bytes seeded with the grammar fingerprint, which covers
+/// the patterns, keywords, filters and policies. Entries are token files as written by save_tokens
+/// and are checked again when read. Reads touch an entry's modification time, and once the entries
+/// pass the size cap the least recently used are removed down to nine tenths of it.
+///
+/// Any number of threads may share a cache. Processes may share a directory too, each keeps its
+/// own estimate of the total size, corrected whenever it evicts.
+class LexCache
+{
+public:
+    static constexpr std::uint64_t default_max_bytes = std::uint64_t{1} << 30;
+
+    explicit LexCache(std::string directory, std::uint64_t max_bytes = default_max_bytes)
+        : directory_(std::move(directory)), max_bytes_(max_bytes)
+    {
+        if (directory_.empty()) directory_ = ".";
+        ::mkdir(directory_.c_str(), 0755);
+        std::lock_guard<std::mutex> lock(mutex_);
+        evict();
+    }
+
+    LexCache(LexCache const&) = delete;
+    LexCache& operator=(LexCache const&) = delete;
+
+    /// Loads the tokens previously stored for source into out, false on a miss
+    template <typename Traits>
+    bool find(std::string_view source, Lexed<typename Traits::token_t>& out)
+    {
+        auto const path = path_of<Traits>(source);
+        TokenFile<Traits> const file(path);
+        if (file.is_valid() && file.source_size() == source.size())
+        {
+            auto loaded = file.template load<typename Traits::token_t>(source);
+            if (loaded.tokens.size() == file.size())
+            {
+                out = std::move(loaded);
+                ::utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /// Stores the tokens of a lexed source, evicting old entries when over the cap
+    template <typename Traits, typename T, typename Allocator>
+    bool store(Lexed<T, Allocator> const& lexed)
+    {
+        auto const path = path_of<Traits>(lexed.source);
+        if (!save_tokens<Traits>(lexed, path)) return false;
+        struct stat info;
+        if (::stat(path.c_str(), &info) != 0) return false;
+        std::lock_guard<std::mutex> lock(mutex_);
+        bytes_ += static_cast<std::uint64_t>(info.st_size);
+        if (bytes_ > max_bytes_) evict();
+        return true;
+    }
+
+    /// Lexes a source, or loads its tokens when they are cached
+    template <typename Traits>
+    Lexed<typename Traits::token_t> lex(std::string_view source)
+    {
+        Lexed<typename Traits::token_t> res;
+        if (find<Traits>(source, res)) return res;
+        res = REGLEX_NAMESPACE::lex<Traits>(source);
+        store<Traits>(res);
+        return res;
+    }
+
+    std::string const& directory() const noexcept { return directory_; }
+    std::uint64_t hits() const noexcept { return hits_.load(std::memory_order_relaxed); }
+    std::uint64_t misses() const noexcept { return misses_.load(std::memory_order_relaxed); }
+
+    /// Estimated bytes in the cache
+    std::uint64_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return bytes_;
+    }
+
+private:
+    static constexpr std::string_view extension = ".tok";
+
+    template <typename Traits>
+    std::string path_of(std::string_view source) const
+    {
+        auto const hash = detail::content_hash(source, grammar_fingerprint<Traits>);
+        char name[33];
+        std::snprintf(name,
+                      sizeof(name),
+                      "%016llx%016llx",
+                      static_cast<unsigned long long>(hash.high),
+                      static_cast<unsigned long long>(hash.low));
+        return directory_ + "/" + name + std::string(extension);
+    }
+
+    // Recounts the entries and removes the least recently used until under the cap, with the lock
+    // held
+    void evict()
+    {
+        struct entry
+        {
+            std::string path;
+            struct timespec used;
+            std::uint64_t size;
+        };
+        std::vector<entry> entries;
+        std::uint64_t total = 0;
+        if (auto* dir = ::opendir(directory_.c_str()))
+        {
+            while (auto const* ent = ::readdir(dir))
+            {
+                std::string_view const name = ent->d_name;
+                if (name.size() <= extension.size() || name.substr(name.size() - extension.size()) != extension)
+                    continue;
+                auto path = directory_ + "/" + std::string(name);
+                struct stat info;
+                if (::stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) continue;
+                total += static_cast<std::uint64_t>(info.st_size);
+#if defined(__APPLE__)
+                auto const used = info.st_mtimespec;
+#else
+                auto const used = info.st_mtim;
+#endif
+                entries.push_back({std::move(path), used, static_cast<std::uint64_t>(info.st_size)});
+            }
+            ::closedir(dir);
+        }
+        if (total > max_bytes_)
+        {
+            std::sort(entries.begin(), entries.end(), [](entry const& a, entry const& b) {
+                return a.used.tv_sec != b.used.tv_sec ? a.used.tv_sec < b.used.tv_sec : a.used.tv_nsec < b.used.tv_nsec;
+            });
+            auto const target = max_bytes_ / 10 * 9;
+            for (auto const& e : entries)
+            {
+                if (total <= target) break;
+                if (std::remove(e.path.c_str()) == 0) total -= e.size;
+            }
+        }
+        bytes_ = total;
+    }
+
+    std::string directory_;
+    std::uint64_t max_bytes_;
+    mutable std::mutex mutex_;
+    std::uint64_t bytes_ = 0;
+    std::atomic<std::uint64_t> hits_{0};
+    std::atomic<std::uint64_t> misses_{0};
+};
+} // namespace REGLEX_NAMESPACE
+
+#endif // REGLEX_CACHE_H
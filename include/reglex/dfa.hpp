@@ -0,0 +1,709 @@
+#pragma once
+#if !defined(REGLEX_DFA_H)
+#define REGLEX_DFA_H
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#include <reglex/reglex.hpp>
+
+namespace REGLEX_NAMESPACE
+{
+namespace detail
+{
+// These are called when a pattern can't be compiled to a DFA. They are deliberately not constexpr,
+// so the build fails with their name in the diagnostic.
+inline void dfa_unsupported_pattern_feature() {}
+inline void dfa_malformed_pattern() {}
+inline void dfa_state_limit_exceeded() {}
+
+static constexpr std::size_t dfa_npos = ~std::size_t{0};
+
+/// Set of byte values, labels the consuming edges of the NFA
+struct byte_set
+{
+    std::array<std::uint64_t, 4> words{};
+
+    constexpr void insert(std::size_t c) noexcept { words[c / 64] |= std::uint64_t{1} << (c % 64); }
+    constexpr void insert(std::size_t lo, std::size_t hi) noexcept
+    {
+        for (auto c = lo; c <= hi; ++c) insert(c);
+    }
+    constexpr void merge(byte_set const& other) noexcept
+    {
+        for (std::size_t i = 0; i < words.size(); ++i) words[i] |= other.words[i];
+    }
+    constexpr void invert() noexcept
+    {
+        for (auto& w : words) w = ~w;
+    }
+    constexpr bool contains(std::size_t c) const noexcept { return (words[c / 64] >> (c % 64)) & 1; }
+    constexpr bool empty() const noexcept { return !(words[0] | words[1] | words[2] | words[3]); }
+};
+
+/// Thompson NFA, every node has at most one consuming edge and two epsilon edges
+template <std::size_t Capacity>
+struct nfa
+{
+    struct node
+    {
+        byte_set bytes;
+        std::size_t next = dfa_npos;
+        std::array<std::size_t, 2> eps{dfa_npos, dfa_npos};
+        // Token index accepted when this node is reached
+        std::size_t accept = dfa_npos;
+    };
+
+    std::array<node, Capacity> nodes{};
+    std::size_t size = 0;
+    std::size_t start = dfa_npos;
+
+    constexpr std::size_t add() noexcept
+    {
+        if (size == Capacity) dfa_state_limit_exceeded();
+        return size++;
+    }
+
+    constexpr void link(std::size_t from, std::size_t to) noexcept
+    {
+        auto& eps = nodes[from].eps;
+        (eps[0] == dfa_npos ? eps[0] : eps[1]) = to;
+    }
+};
+
+/// Recursive descent parser producing NFA fragments for the regex subset a DFA can represent.
+/// When approximate is set, assertions and lookaheads are dropped rather than rejected, which
+/// yields a superset of the pattern language.
+template <std::size_t Capacity>
+struct nfa_parser
+{
+    struct fragment
+    {
+        std::size_t start;
+        std::size_t end;
+    };
+
+    nfa<Capacity>& out;
+    std::string_view pat;
+    bool approximate = false;
+    std::size_t pos = 0;
+
+    constexpr bool at(char c) const noexcept { return pos < pat.size() && pat[pos] == c; }
+
+    constexpr void unsupported() const noexcept
+    {
+        if (!approximate) dfa_unsupported_pattern_feature();
+    }
+
+    constexpr fragment empty() noexcept
+    {
+        auto const n = out.add();
+        return {n, n};
+    }
+
+    constexpr fragment consume(byte_set const& bytes) noexcept
+    {
+        auto const n = out.add();
+        auto const e = out.add();
+        out.nodes[n].bytes = bytes;
+        out.nodes[n].next = e;
+        return {n, e};
+    }
+
+    constexpr fragment parse() noexcept
+    {
+        auto const frag = parse_alternation();
+        // Anything left over is an unbalanced group
+        if (pos != pat.size()) dfa_malformed_pattern();
+        return frag;
+    }
+
+    constexpr fragment parse_alternation() noexcept
+    {
+        auto frag = parse_sequence();
+        while (at('|'))
+        {
+            ++pos;
+            auto const rhs = parse_sequence();
+            auto const s = out.add();
+            auto const e = out.add();
+            out.link(s, frag.start);
+            out.link(s, rhs.start);
+            out.link(frag.end, e);
+            out.link(rhs.end, e);
+            frag = {s, e};
+        }
+        return frag;
+    }
+
+    constexpr fragment parse_sequence() noexcept
+    {
+        fragment frag{dfa_npos, dfa_npos};
+        while (pos < pat.size() && !at('|') && !at(')'))
+        {
+            auto const next = parse_repeat();
+            if (frag.start == dfa_npos)
+            {
+                frag = next;
+                continue;
+            }
+            out.link(frag.end, next.start);
+            frag.end = next.end;
+        }
+        return frag.start == dfa_npos ? empty() : frag;
+    }
+
+    constexpr fragment parse_repeat() noexcept
+    {
+        auto frag = parse_atom();
+        while (at('*') || at('+') || at('?'))
+        {
+            auto const op = pat[pos++];
+            // Lazy and possessive quantifiers change which match is chosen, which a DFA taking the
+            // longest can't follow, and possessive ones can rule matches out. Dropping them leaves a
+            // superset of what the pattern matches, which is all the approximate DFA needs.
+            if (at('?') || at('+'))
+            {
+                unsupported();
+                ++pos;
+            }
+            if (op == '+')
+            {
+                auto const e = out.add();
+                out.link(frag.end, frag.start);
+                out.link(frag.end, e);
+                frag.end = e;
+                continue;
+            }
+            auto const s = out.add();
+            auto const e = out.add();
+            out.link(s, frag.start);
+            out.link(s, e);
+            if (op == '*') out.link(frag.end, frag.start);
+            out.link(frag.end, e);
+            frag = {s, e};
+        }
+        if (at('{')) dfa_unsupported_pattern_feature();
+        return frag;
+    }
+
+    constexpr fragment parse_atom() noexcept
+    {
+        auto const c = pat[pos++];
+        switch (c)
+        {
+        case '(':
+        {
+            bool discard = false;
+            if (at('?'))
+            {
+                ++pos;
+                auto const kind = pos < pat.size() ? pat[pos++] : '\0';
+                if (kind == '=' || kind == '!')
+                {
+                    unsupported();
+                    discard = true;
+                }
+                else if (kind != ':')
+                {
+                    dfa_unsupported_pattern_feature();
+                }
+            }
+            auto const inner = parse_alternation();
+            if (!at(')')) dfa_malformed_pattern();
+            ++pos;
+            return discard ? empty() : inner;
+        }
+        case '[': return consume(parse_class());
+        case '.':
+        {
+            byte_set any;
+            any.invert();
+            return consume(any);
+        }
+        case '^':
+        case '$': unsupported(); return empty();
+        case '\\':
+        {
+            if (pos < pat.size())
+            {
+                auto const e = pat[pos];
+                if (e == 'b' || e == 'B' || e == 'A' || e == 'z' || e == 'Z')
+                {
+                    ++pos;
+                    unsupported();
+                    return empty();
+                }
+            }
+            return consume(parse_escape().set);
+        }
+        case '*':
+        case '+':
+        case '?':
+        case '{':
+        case ')': dfa_malformed_pattern(); return empty();
+        default:
+        {
+            byte_set literal;
+            literal.insert(static_cast<unsigned char>(c));
+            return consume(literal);
+        }
+        }
+    }
+
+    static constexpr byte_set digits() noexcept
+    {
+        byte_set set;
+        set.insert('0', '9');
+        return set;
+    }
+
+    static constexpr byte_set word() noexcept
+    {
+        byte_set set = digits();
+        set.insert('a', 'z');
+        set.insert('A', 'Z');
+        set.insert('_');
+        return set;
+    }
+
+    static constexpr byte_set space() noexcept
+    {
+        byte_set set;
+        for (auto c : {' ', '\t', '\n', '\v', '\f', '\r'}) set.insert(static_cast<unsigned char>(c));
+        return set;
+    }
+
+    static constexpr byte_set invert(byte_set set) noexcept
+    {
+        set.invert();
+        return set;
+    }
+
+    static constexpr std::size_t hex_digit(char c) noexcept
+    {
+        if (c >= '0' && c <= '9') return static_cast<std::size_t>(c - '0');
+        if (c >= 'a' && c <= 'f') return static_cast<std::size_t>(c - 'a' + 10);
+        if (c >= 'A' && c <= 'F') return static_cast<std::size_t>(c - 'A' + 10);
+        dfa_malformed_pattern();
+        return 0;
+    }
+
+    // An escape is either one byte, which can bound a range in a class, or a class such as \d
+    struct escape
+    {
+        byte_set set;
+        std::size_t byte = 0;
+        bool single = true;
+    };
+
+    static constexpr escape byte_escape(std::size_t c) noexcept
+    {
+        escape out;
+        out.set.insert(c);
+        out.byte = c;
+        return out;
+    }
+
+    static constexpr escape class_escape(byte_set const& set) noexcept
+    {
+        escape out;
+        out.set = set;
+        out.single = false;
+        return out;
+    }
+
+    // Parses the escape following a backslash
+    constexpr escape parse_escape() noexcept
+    {
+        if (pos == pat.size()) dfa_malformed_pattern();
+        auto const c = pat[pos++];
+        switch (c)
+        {
+        case 'd': return class_escape(digits());
+        case 'w': return class_escape(word());
+        case 's': return class_escape(space());
+        case 'D': return class_escape(invert(digits()));
+        case 'W': return class_escape(invert(word()));
+        case 'S': return class_escape(invert(space()));
+        case 'n': return byte_escape('\n');
+        case 't': return byte_escape('\t');
+        case 'r': return byte_escape('\r');
+        case 'f': return byte_escape('\f');
+        case 'v': return byte_escape('\v');
+        case '0': return byte_escape(0);
+        case 'x':
+        {
+            if (pos + 2 > pat.size()) dfa_malformed_pattern();
+            auto const hi = hex_digit(pat[pos++]);
+            return byte_escape(hi * 16 + hex_digit(pat[pos++]));
+        }
+        default:
+            // Back references can't be represented
+            if (c >= '1' && c <= '9') dfa_unsupported_pattern_feature();
+            return byte_escape(static_cast<unsigned char>(c));
+        }
+    }
+
+    constexpr byte_set parse_class() noexcept
+    {
+        byte_set set;
+        bool const negate = at('^');
+        if (negate) ++pos;
+        // A leading bracket is a literal
+        bool first = true;
+        while (pos < pat.size() && (first || !at(']')))
+        {
+            first = false;
+            // Escapes which denote a class can't begin a range
+            if (at('\\'))
+            {
+                ++pos;
+                auto const escaped = parse_escape();
+                if (!escaped.single || !at('-') || pos + 1 >= pat.size() || pat[pos + 1] == ']')
+                {
+                    set.merge(escaped.set);
+                    continue;
+                }
+                ++pos;
+                set.insert(escaped.byte, parse_class_char());
+                continue;
+            }
+            auto const lo = static_cast<unsigned char>(pat[pos++]);
+            if (at('-') && pos + 1 < pat.size() && pat[pos + 1] != ']')
+            {
+                ++pos;
+                set.insert(lo, parse_class_char());
+                continue;
+            }
+            set.insert(lo);
+        }
+        if (!at(']')) dfa_malformed_pattern();
+        ++pos;
+        if (negate) set.invert();
+        return set;
+    }
+
+    // The upper bound of a range inside a class
+    constexpr std::size_t parse_class_char() noexcept
+    {
+        if (!at('\\')) return static_cast<unsigned char>(pat[pos++]);
+        ++pos;
+        auto const escaped = parse_escape();
+        // A class can't bound a range
+        if (!escaped.single) dfa_malformed_pattern();
+        return escaped.byte;
+    }
+};
+
+// Upper bound on the NFA size for a grammar, each pattern character produces at most two nodes and
+// each empty sequence one more
+template <typename Traits, std::size_t... I>
+constexpr std::size_t nfa_capacity(std::index_sequence<I...>) noexcept
+{
+    using matcher_t = typename Traits::matcher_t;
+    return 1 + ((matcher_t::template pattern<Traits::template lookup<I>>.size() * 3 + 3) + ... + 0);
+}
+
+// Builds the NFA for every token pattern, joined by a chain of epsilon nodes so that they all begin
+// at the NFA start
+template <typename Traits, std::size_t Capacity, std::size_t... I>
+constexpr auto build_nfa(bool approximate, std::index_sequence<I...>) noexcept
+{
+    using matcher_t = typename Traits::matcher_t;
+    nfa<Capacity> out{};
+    std::size_t chain = out.start = out.add();
+    auto const add_token = [&](std::size_t index, std::string_view pattern) {
+        // Tokens without a pattern are never matched
+        if (pattern.empty()) return;
+        auto const frag = nfa_parser<Capacity>{out, pattern, approximate}.parse();
+        out.nodes[frag.end].accept = index;
+        auto const next = out.add();
+        out.link(chain, frag.start);
+        out.link(chain, next);
+        chain = next;
+    };
+    (add_token(I, matcher_t::template pattern<Traits::template lookup<I>>), ...);
+    return out;
+}
+
+/// Partition of the byte values into classes which every NFA edge treats identically
+struct byte_classes
+{
+    std::array<std::size_t, 256> of{};
+    std::array<std::size_t, 256> representative{};
+    std::size_t count = 1;
+};
+
+template <typename Nfa>
+constexpr byte_classes build_byte_classes(Nfa const& in) noexcept
+{
+    byte_classes classes;
+    for (std::size_t n = 0; n < in.size; ++n)
+    {
+        auto const& bytes = in.nodes[n].bytes;
+        if (bytes.empty()) continue;
+        // Split every class by membership of this edge
+        std::array<std::size_t, 512> remap{};
+        for (auto& r : remap) r = dfa_npos;
+        std::size_t count = 0;
+        for (std::size_t b = 0; b < 256; ++b)
+        {
+            auto& slot = remap[classes.of[b] * 2 + bytes.contains(b)];
+            if (slot == dfa_npos) slot = count++;
+            classes.of[b] = slot;
+        }
+        classes.count = count;
+    }
+    for (std::size_t b = 256; b-- > 0;)
+    {
+        classes.representative[classes.of[b]] = b;
+    }
+    return classes;
+}
+
+/// Set of NFA nodes, identifies a DFA state during subset construction
+template <std::size_t Nodes>
+struct node_set
+{
+    std::array<std::uint64_t, (Nodes + 63) / 64> words{};
+
+    constexpr void insert(std::size_t n) noexcept { words[n / 64] |= std::uint64_t{1} << (n % 64); }
+    constexpr bool contains(std::size_t n) const noexcept { return (words[n / 64] >> (n % 64)) & 1; }
+    constexpr bool operator==(node_set const& other) const noexcept
+    {
+        for (std::size_t i = 0; i < words.size(); ++i)
+            if (words[i] != other.words[i]) return false;
+        return true;
+    }
+    constexpr std::size_t hash() const noexcept
+    {
+        std::uint64_t h = 14695981039346656037ull;
+        for (auto w : words) h = (h ^ w) * 1099511628211ull;
+        return static_cast<std::size_t>(h ^ (h >> 29));
+    }
+    // Calls f with the index of every node in the set
+    template <typename F>
+    constexpr void each(F&& f) const noexcept
+    {
+        for (std::size_t i = 0; i < words.size(); ++i)
+        {
+            for (auto w = words[i]; w; w &= w - 1)
+            {
+                f(i * 64 + static_cast<std::size_t>(__builtin_ctzll(w)));
+            }
+        }
+    }
+};
+
+/// Unminimized DFA, produced by subset construction. State zero is the dead state.
+template <std::size_t Nodes, std::size_t Classes, std::size_t MaxStates>
+struct subset_dfa
+{
+    std::array<node_set<Nodes>, MaxStates> sets{};
+    std::array<std::size_t, MaxStates * Classes> next{};
+    std::array<std::size_t, MaxStates> accept{};
+    std::size_t size = 0;
+    std::size_t start = 0;
+};
+
+template <std::size_t Classes, std::size_t MaxStates, typename Nfa, std::size_t Nodes = std::tuple_size_v<decltype(Nfa::nodes)>>
+constexpr auto build_subset_dfa(Nfa const& in, byte_classes const& classes, std::size_t none) noexcept
+{
+    subset_dfa<Nodes, Classes, MaxStates> out{};
+    // Open addressed lookup from node set to state
+    std::array<std::size_t, MaxStates * 2> lookup{};
+    for (auto& l : lookup) l = dfa_npos;
+    std::array<std::size_t, Nodes> stack{};
+
+    auto const closure = [&](node_set<Nodes>& set) {
+        std::size_t top = 0;
+        set.each([&](std::size_t n) { stack[top++] = n; });
+        while (top)
+        {
+            for (auto e : in.nodes[stack[--top]].eps)
+            {
+                if (e == dfa_npos || set.contains(e)) continue;
+                set.insert(e);
+                stack[top++] = e;
+            }
+        }
+    };
+    auto const intern = [&](node_set<Nodes> const& set) {
+        auto slot = set.hash() % lookup.size();
+        for (; lookup[slot] != dfa_npos; slot = (slot + 1) % lookup.size())
+        {
+            if (out.sets[lookup[slot]] == set) return lookup[slot];
+        }
+        if (out.size == MaxStates) dfa_state_limit_exceeded();
+        auto const state = out.size++;
+        out.sets[state] = set;
+        lookup[slot] = state;
+        // Lowest token index wins when several patterns accept
+        out.accept[state] = none;
+        set.each([&](std::size_t n) {
+            if (in.nodes[n].accept < out.accept[state]) out.accept[state] = in.nodes[n].accept;
+        });
+        return state;
+    };
+
+    intern(node_set<Nodes>{});
+    node_set<Nodes> initial{};
+    initial.insert(in.start);
+    closure(initial);
+    out.start = intern(initial);
+    for (std::size_t s = 0; s < out.size; ++s)
+    {
+        for (std::size_t c = 0; c < Classes; ++c)
+        {
+            auto const byte = classes.representative[c];
+            node_set<Nodes> moved{};
+            out.sets[s].each([&](std::size_t n) {
+                auto const& node = in.nodes[n];
+                if (node.next != dfa_npos && node.bytes.contains(byte)) moved.insert(node.next);
+            });
+            closure(moved);
+            out.next[s * Classes + c] = intern(moved);
+        }
+    }
+    return out;
+}
+
+/// Partition of the subset DFA states into equivalence classes (Moore's algorithm)
+template <std::size_t MaxStates>
+struct dfa_partition
+{
+    std::array<std::size_t, MaxStates> block{};
+    std::size_t count = 0;
+};
+
+template <std::size_t Classes, typename Subset, std::size_t MaxStates = std::tuple_size_v<decltype(Subset::accept)>>
+constexpr auto minimize(Subset const& in) noexcept
+{
+    dfa_partition<MaxStates> part{};
+    // The dead state goes first, so that it keeps index zero. Otherwise states are split by what
+    // they accept.
+    std::array<std::size_t, MaxStates> order{};
+    std::array<std::size_t, MaxStates * 2> lookup{};
+    std::array<std::size_t, MaxStates> next_block{};
+
+    auto const signature_hash = [&](std::size_t s) {
+        std::uint64_t h = 14695981039346656037ull ^ (part.block[s] * 31 + in.accept[s]);
+        for (std::size_t c = 0; c < Classes; ++c) h = (h ^ part.block[in.next[s * Classes + c]]) * 1099511628211ull;
+        return static_cast<std::size_t>(h ^ (h >> 29));
+    };
+    auto const same_signature = [&](std::size_t a, std::size_t b) {
+        if (part.block[a] != part.block[b] || in.accept[a] != in.accept[b]) return false;
+        for (std::size_t c = 0; c < Classes; ++c)
+        {
+            if (part.block[in.next[a * Classes + c]] != part.block[in.next[b * Classes + c]]) return false;
+        }
+        return true;
+    };
+
+    // Start with everything in one block, the accept value in the signature does the first split
+    part.count = 1;
+    for (;;)
+    {
+        for (auto& l : lookup) l = dfa_npos;
+        std::size_t count = 0;
+        for (std::size_t s = 0; s < in.size; ++s)
+        {
+            auto slot = signature_hash(s) % lookup.size();
+            for (; lookup[slot] != dfa_npos && !same_signature(order[lookup[slot]], s); slot = (slot + 1) % lookup.size())
+            {
+            }
+            if (lookup[slot] == dfa_npos)
+            {
+                lookup[slot] = count;
+                order[count++] = s;
+            }
+            next_block[s] = lookup[slot];
+        }
+        for (std::size_t s = 0; s < in.size; ++s) part.block[s] = next_block[s];
+        if (count == part.count) break;
+        part.count = count;
+    }
+    return part;
+}
+
+/// Final minimized transition table
+template <std::size_t States, std::size_t Classes, std::size_t TokenCount>
+struct dfa_table
+{
+    using state_t = std::conditional_t<(States <= 0x100), std::uint8_t, std::uint16_t>;
+    using index_t = std::conditional_t<(TokenCount < 0x100), std::uint8_t, std::uint16_t>;
+    static constexpr state_t dead = 0;
+
+    std::array<std::uint8_t, 256> byte_class{};
+    std::array<state_t, States * Classes> next{};
+    std::array<index_t, States> accept{};
+    state_t start = 0;
+};
+
+// With Approximate set, lookaheads and anchors are dropped, giving a DFA for a superset of the
+// grammar. That is enough to tell when no token can extend past a point.
+template <typename Traits, bool Approximate = false>
+struct make_dfa
+{
+    static constexpr std::size_t capacity = nfa_capacity<Traits>(std::make_index_sequence<Traits::token_count>{});
+    static constexpr auto graph = build_nfa<Traits, capacity>(Approximate, std::make_index_sequence<Traits::token_count>{});
+    static constexpr auto classes = build_byte_classes(graph);
+    static constexpr auto subset = build_subset_dfa<classes.count, Traits::dfa_max_states>(graph, classes, Traits::token_count);
+    static constexpr auto partition = minimize<classes.count>(subset);
+
+    static constexpr auto impl() noexcept
+    {
+        using table_t = dfa_table<partition.count, classes.count, Traits::token_count>;
+        using state_t = typename table_t::state_t;
+        table_t table{};
+        for (std::size_t b = 0; b < 256; ++b)
+        {
+            table.byte_class[b] = static_cast<std::uint8_t>(classes.of[b]);
+        }
+        for (std::size_t s = 0; s < subset.size; ++s)
+        {
+            auto const block = partition.block[s];
+            table.accept[block] = static_cast<typename table_t::index_t>(subset.accept[s]);
+            for (std::size_t c = 0; c < classes.count; ++c)
+            {
+                table.next[block * classes.count + c] =
+                    static_cast<state_t>(partition.block[subset.next[s * classes.count + c]]);
+            }
+        }
+        table.start = static_cast<state_t>(partition.block[subset.start]);
+        return table;
+    }
+};
+
+// Final DFA for a grammar, built once per traits type
+template <typename Traits, bool Approximate = false>
+static constexpr auto dfa = make_dfa<Traits, Approximate>::impl();
+} // namespace detail
+
+/// Matching engine which compiles every token pattern into a single minimized DFA at compile time.
+/// Matching is one table step per input byte. The longest match is chosen, ties are broken by enum
+/// order, as flex does. Lookaheads, anchors and counted repetition are rejected at compile time.
+struct dfa_engine
+{
+    template <typename Traits>
+    static constexpr Match match(std::string_view src) noexcept
+    {
+        auto const& dfa = detail::dfa<Traits>;
+        constexpr std::size_t classes = detail::make_dfa<Traits>::classes.count;
+        Match result{Traits::token_count, 0};
+        std::size_t state = dfa.start;
+        for (std::size_t i = 0; i < src.size(); ++i)
+        {
+            state = dfa.next[state * classes + dfa.byte_class[static_cast<unsigned char>(src[i])]];
+            if (state == dfa.dead) break;
+            if (dfa.accept[state] < Traits::token_count) result = Match{dfa.accept[state], i + 1};
+        }
+        return result;
+    }
+};
+} // namespace REGLEX_NAMESPACE
+
+#endif // REGLEX_DFA_H
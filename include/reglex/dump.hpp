@@ -0,0 +1,332 @@
+#pragma once
+#if !defined(REGLEX_DUMP_H)
+#define REGLEX_DUMP_H
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+
+#include <unistd.h>
+
+#include <reglex/reglex.hpp>
+#include <reglex/serialize.hpp>
+
+namespace REGLEX_NAMESPACE
+{
+/// Layouts a TokenWriter can produce
+enum class DumpFormat
+{
+    // "TYPE line" per token, after a "==> name <==" line when the source is named
+    Text,
+    // A header row, then path, type, line, offset, length and lexeme per token separated by tabs,
+    // with tabs, newlines, carriage returns and backslashes in the path and lexeme escaped
+    Tsv,
+    // A section per source, laid out as dump_format describes
+    Binary
+};
+
+/// Binary dump layout. All fields are little endian, and each source written makes a section:
+///
+///     header     40 bytes, see below
+///     name       name size bytes naming the source, such as its path, may be empty
+///     types      type table size bytes, the name of each token type in enum order, each followed
+///                by a newline
+///     records    record count records of u64 offset, then u32 length, first line, enum index and
+///                lines spanned
+///
+/// The header holds the magic "REGLEXDP", u32 version and record size, then u64 grammar
+/// fingerprint and record count, then u32 name size and type table size. A reader can check the
+/// fingerprint against grammar_fingerprint, or map enum indexes through the type table.
+struct dump_format
+{
+    static constexpr char magic[8] = {'R', 'E', 'G', 'L', 'E', 'X', 'D', 'P'};
+    static constexpr std::uint32_t version = 1;
+    static constexpr std::size_t header_size = 40;
+    static constexpr std::size_t record_size = 24;
+};
+
+namespace detail
+{
+// Per enumerator dump data, looked up by underlying value so no search is needed per token. Names
+// carry the separator the format follows them with.
+template <typename TokenType, char Separator>
+struct dump_names
+{
+    static constexpr auto names = magic_enum::enum_names<TokenType>();
+    static constexpr auto values = magic_enum::enum_values<TokenType>();
+    static constexpr long long value_of(TokenType type) noexcept
+    {
+        return static_cast<long long>(static_cast<std::underlying_type_t<TokenType>>(type));
+    }
+    static constexpr long long lowest = [] {
+        auto n = value_of(values[0]);
+        for (auto v : values)
+        {
+            n = std::min(n, value_of(v));
+        }
+        return n;
+    }();
+    // magic_enum only sees values within its small reflection range, so this stays short
+    static constexpr std::size_t range = [] {
+        long long n = 0;
+        for (auto v : values)
+        {
+            n = std::max(n, value_of(v) - lowest);
+        }
+        return static_cast<std::size_t>(n) + 1;
+    }();
+    static constexpr std::size_t longest = [] {
+        std::size_t n = 0;
+        for (auto name : names)
+        {
+            n = std::max(n, name.size());
+        }
+        return n;
+    }();
+
+    struct table
+    {
+        std::array<std::array<char, longest + 1>, range> text{};
+        std::array<std::uint8_t, range> size{};
+        std::array<std::uint32_t, range> index{};
+    };
+
+    static constexpr table impl() noexcept
+    {
+        table out{};
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            auto const slot = static_cast<std::size_t>(value_of(values[i]) - lowest);
+            for (std::size_t c = 0; c < names[i].size(); ++c)
+            {
+                out.text[slot][c] = names[i][c];
+            }
+            out.text[slot][names[i].size()] = Separator;
+            out.size[slot] = static_cast<std::uint8_t>(names[i].size() + 1);
+            out.index[slot] = static_cast<std::uint32_t>(i);
+        }
+        return out;
+    }
+
+    static constexpr table value = impl();
+
+    static constexpr std::size_t slot(TokenType type) noexcept { return static_cast<std::size_t>(value_of(type) - lowest); }
+};
+} // namespace detail
+
+/// Writes token dumps to a file descriptor through a large buffer. Enum names are copied from tables
+/// built at compile time and numbers are formatted with to_chars, the buffer goes out with write(2)
+/// whenever it fills. Anything left is written on flush or destruction.
+class TokenWriter
+{
+public:
+    static constexpr std::size_t default_capacity = std::size_t{1} << 20;
+
+    explicit TokenWriter(int fd, DumpFormat format = DumpFormat::Text, std::size_t capacity = default_capacity)
+        : fd_(fd), format_(format), capacity_(std::max<std::size_t>(capacity, 256)),
+          buffer_(std::make_unique<char[]>(capacity_))
+    {
+        if (format_ == DumpFormat::Tsv) append("path\ttype\tline\toffset\tlength\tlexeme\n");
+    }
+
+    TokenWriter(TokenWriter const&) = delete;
+    TokenWriter& operator=(TokenWriter const&) = delete;
+
+    ~TokenWriter() { flush(); }
+
+    /// Appends every token of a source lexed with Traits, of either layout. name labels the source,
+    /// such as with its path, so that the sources of a dump can be told apart.
+    template <typename Traits, typename T, typename Allocator>
+    void write(Lexed<T, Allocator> const& lexed, std::string_view name = {})
+    {
+        // The format is picked once, each loop then runs without branching on it
+        switch (format_)
+        {
+        case DumpFormat::Text: return write_text(lexed, name);
+        case DumpFormat::Tsv: return write_tsv(lexed, name);
+        case DumpFormat::Binary: return write_binary<Traits>(lexed, name);
+        }
+    }
+
+    /// Writes out the buffer, false if any write so far has failed
+    bool flush()
+    {
+        std::size_t done = 0;
+        while (done < size_ && ok_)
+        {
+            auto const n = ::write(fd_, buffer_.get() + done, size_ - done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) ok_ = false;
+            else done += static_cast<std::size_t>(n);
+        }
+        size_ = 0;
+        return ok_;
+    }
+
+    bool ok() const noexcept { return ok_; }
+
+private:
+    // Digits in the largest 64 bit number
+    static constexpr std::size_t max_digits = 20;
+
+    template <typename T, typename Allocator>
+    void write_text(Lexed<T, Allocator> const& lexed, std::string_view name)
+    {
+        using names_t = detail::dump_names<typename T::token_type_t, ' '>;
+        auto const& names = names_t::value;
+        if (!name.empty())
+        {
+            append("==> ");
+            append(name);
+            append(" <==\n");
+        }
+        for (auto const& tok : lexed.tokens)
+        {
+            auto const index = names_t::slot(tok.type);
+            reserve(names.size[index] + max_digits + 1);
+            append_raw(names.text[index].data(), names.size[index]);
+            append_number(lexed.first_line(tok));
+            put('\n');
+        }
+    }
+
+    template <typename T, typename Allocator>
+    void write_tsv(Lexed<T, Allocator> const& lexed, std::string_view name)
+    {
+        using names_t = detail::dump_names<typename T::token_type_t, '\t'>;
+        auto const& names = names_t::value;
+        for (auto const& tok : lexed.tokens)
+        {
+            auto const index = names_t::slot(tok.type);
+            auto const lexeme = lexed.lexeme(tok);
+            append_escaped(name);
+            reserve(1 + names.size[index] + 3 * (max_digits + 1));
+            put('\t');
+            append_raw(names.text[index].data(), names.size[index]);
+            append_number(lexed.first_line(tok));
+            put('\t');
+            append_number(lexed.offset(tok));
+            put('\t');
+            append_number(lexeme.size());
+            put('\t');
+            append_escaped(lexeme);
+            reserve(1);
+            put('\n');
+        }
+    }
+
+    template <typename Traits, typename T, typename Allocator>
+    void write_binary(Lexed<T, Allocator> const& lexed, std::string_view name)
+    {
+        using names_t = detail::dump_names<typename T::token_type_t, ' '>;
+        std::uint32_t types_size = 0;
+        for (auto const& type : names_t::names)
+        {
+            types_size += static_cast<std::uint32_t>(type.size() + 1);
+        }
+        reserve(dump_format::header_size);
+        append_raw(dump_format::magic, sizeof(dump_format::magic));
+        put_le(dump_format::version);
+        put_le(static_cast<std::uint32_t>(dump_format::record_size));
+        put_le(grammar_fingerprint<Traits>);
+        put_le(static_cast<std::uint64_t>(lexed.tokens.size()));
+        put_le(static_cast<std::uint32_t>(name.size()));
+        put_le(types_size);
+        append(name);
+        for (auto const& type : names_t::names)
+        {
+            append(type);
+            reserve(1);
+            put('\n');
+        }
+        for (auto const& tok : lexed.tokens)
+        {
+            reserve(dump_format::record_size);
+            put_le(static_cast<std::uint64_t>(lexed.offset(tok)));
+            put_le(static_cast<std::uint32_t>(lexed.lexeme(tok).size()));
+            put_le(static_cast<std::uint32_t>(lexed.first_line(tok)));
+            put_le(names_t::value.index[names_t::slot(tok.type)]);
+            put_le(static_cast<std::uint32_t>(lexed.num_lines(tok)));
+        }
+    }
+
+    // Makes room for n more bytes, n must be no more than the capacity
+    void reserve(std::size_t n)
+    {
+        if (capacity_ - size_ < n) flush();
+    }
+
+    void put(char c) noexcept { buffer_[size_++] = c; }
+
+    void append_raw(char const* data, std::size_t n) noexcept
+    {
+        std::memcpy(buffer_.get() + size_, data, n);
+        size_ += n;
+    }
+
+    // Appends any amount, passing through the buffer a piece at a time
+    void append(std::string_view text)
+    {
+        while (!text.empty())
+        {
+            reserve(1);
+            auto const n = std::min(text.size(), capacity_ - size_);
+            append_raw(text.data(), n);
+            text.remove_prefix(n);
+        }
+    }
+
+    void append_number(std::size_t value) noexcept
+    {
+        auto const res = std::to_chars(buffer_.get() + size_, buffer_.get() + capacity_, value);
+        size_ = static_cast<std::size_t>(res.ptr - buffer_.get());
+    }
+
+    void append_escaped(std::string_view text)
+    {
+        std::size_t start = 0;
+        for (std::size_t i = 0; i < text.size(); ++i)
+        {
+            char escape = 0;
+            switch (text[i])
+            {
+            case '\t': escape = 't'; break;
+            case '\n': escape = 'n'; break;
+            case '\r': escape = 'r'; break;
+            case '\\': escape = '\\'; break;
+            default: continue;
+            }
+            append(text.substr(start, i - start));
+            reserve(2);
+            put('\\');
+            put(escape);
+            start = i + 1;
+        }
+        append(text.substr(start));
+    }
+
+    template <typename U>
+    void put_le(U value) noexcept
+    {
+        for (std::size_t i = 0; i < sizeof(U); ++i)
+        {
+            put(static_cast<char>(value >> (8 * i) & 0xFF));
+        }
+    }
+
+    int fd_;
+    DumpFormat format_;
+    std::size_t capacity_;
+    std::unique_ptr<char[]> buffer_;
+    std::size_t size_ = 0;
+    bool ok_ = true;
+};
+} // namespace REGLEX_NAMESPACE
+
+#endif // REGLEX_DUMP_H
@@ -0,0 +1,115 @@
+#pragma once
+#if !defined(REGLEX_FILES_H)
+#define REGLEX_FILES_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <reglex/cache.hpp>
+#include <reglex/mmap.hpp>
+#include <reglex/parallel.hpp>
+#include <reglex/pool.hpp>
+
+namespace REGLEX_NAMESPACE
+{
+struct LexFilesOptions
+{
+    // Worker threads, zero for the hardware concurrency
+    std::size_t threads = 0;
+    // Files larger than this are split into chunks of about this size, lexed as separate tasks
+    std::size_t split_size = std::size_t{8} << 20;
+    // When set, files whose tokens are cached are loaded rather than lexed, and the rest stored
+    LexCache* cache = nullptr;
+};
+
+/// One input of lex_files. The lexed tokens view the file, which is kept open alongside them.
+template <typename T>
+struct LexedFile
+{
+    std::string path;
+    // False when the file could not be read, the tokens are then empty
+    bool ok = false;
+    std::unique_ptr<MappedFile> file;
+    Lexed<T> lexed;
+    // Time spent opening the file, and from the start of lexing to the final token
+    std::chrono::nanoseconds load_time{0};
+    std::chrono::nanoseconds lex_time{0};
+};
+
+namespace detail
+{
+// State shared by the chunk tasks of one split file, the last to finish stitches the result
+template <typename T>
+struct split_job
+{
+    std::vector<Chunk<T>> chunks;
+    std::atomic<std::size_t> remaining{0};
+    std::chrono::steady_clock::time_point start;
+};
+} // namespace detail
+
+/// Lexes many files on a work stealing pool, returning the results in input order. Every file is
+/// a task, and files over the split size are divided into chunks as parallel_lex does, so that one
+/// very large file doesn't hold up the batch. An exception thrown while lexing, such as
+/// std::bad_alloc, is rethrown once the other tasks have finished.
+template <typename Traits>
+std::vector<LexedFile<typename Traits::token_t>> lex_files(std::vector<std::string> const& paths,
+                                                          LexFilesOptions const& options = {})
+{
+    using token_t = typename Traits::token_t;
+    using clock = std::chrono::steady_clock;
+    std::vector<LexedFile<token_t>> results(paths.size());
+    detail::work_stealing_pool pool(options.threads);
+    auto const split_size = std::max<std::size_t>(options.split_size, detail::parallel_min_chunk);
+
+    for (std::size_t i = 0; i < paths.size(); ++i)
+    {
+        pool.submit([&, i] {
+            auto& out = results[i];
+            out.path = paths[i];
+            auto const opened = clock::now();
+            out.file = std::make_unique<MappedFile>(paths[i]);
+            auto const start = clock::now();
+            out.load_time = start - opened;
+            out.ok = out.file->is_open();
+            if (!out.ok) return;
+            auto const source = out.file->view();
+            if (options.cache && options.cache->template find<Traits>(source, out.lexed))
+            {
+                out.lex_time = clock::now() - start;
+                return;
+            }
+            if (source.size() <= split_size)
+            {
+                out.lexed = lex<Traits>(source);
+                out.lex_time = clock::now() - start;
+                if (options.cache) options.cache->template store<Traits>(out.lexed);
+                return;
+            }
+            out.lexed.source = source;
+            if constexpr (detail::is_compact_token<token_t>::value) out.lexed.lines = LineIndex(source);
+            auto job = std::make_shared<detail::split_job<token_t>>();
+            job->chunks = detail::split_chunks<token_t>(source, (source.size() + split_size - 1) / split_size);
+            job->remaining = job->chunks.size();
+            job->start = start;
+            for (std::size_t c = 0; c < job->chunks.size(); ++c)
+            {
+                pool.submit([&out, &options, job, c] {
+                    detail::lex_chunk<Traits>(out.lexed.source, job->chunks[c]);
+                    if (job->remaining.fetch_sub(1) != 1) return;
+                    detail::stitch_chunks<Traits>(out.lexed, job->chunks);
+                    out.lex_time = clock::now() - job->start;
+                    if (options.cache) options.cache->template store<Traits>(out.lexed);
+                });
+            }
+        });
+    }
+    pool.wait();
+    return results;
+}
+} // namespace REGLEX_NAMESPACE
+
+#endif // REGLEX_FILES_H
@@ -0,0 +1,358 @@
+#pragma once
+#if !defined(REGLEX_INCREMENTAL_H)
+#define REGLEX_INCREMENTAL_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include <reglex/dfa.hpp>
+
+namespace REGLEX_NAMESPACE
+{
+namespace detail
+{
+// For every byte class and DFA state, the set of states which step to it on that class, as a bit
+// set of (states + 63) / 64 words. Built once per grammar on first use.
+template <typename Traits>
+std::vector<std::uint64_t> const& reverse_transitions()
+{
+    static std::vector<std::uint64_t> const table = [] {
+        auto const& dfa = detail::dfa<Traits, true>;
+        constexpr std::size_t classes = make_dfa<Traits, true>::classes.count;
+        constexpr std::size_t states = std::tuple_size_v<decltype(dfa.accept)>;
+        constexpr std::size_t words = (states + 63) / 64;
+        std::vector<std::uint64_t> out(classes * states * words);
+        for (std::size_t q = 0; q < states; ++q)
+        {
+            for (std::size_t c = 0; c < classes; ++c)
+            {
+                auto const to = dfa.next[q * classes + c];
+                out[(c * states + to) * words + q / 64] |= std::uint64_t{1} << (q % 64);
+            }
+        }
+        return out;
+    }();
+    return table;
+}
+
+// Walks the tokens of source from a point where no match is live, tracking the DFA state of every
+// match begun since which still is. Token starts where none are, at least stride past the last
+// point, are added to points. Stops at the first such token start at or after until, returning
+// it, or at the end of what lexes, returning npos.
+template <typename Traits>
+std::size_t find_resync_points(std::string_view source,
+                               std::size_t from,
+                               std::size_t until,
+                               std::size_t stride,
+                               std::vector<std::size_t>& points)
+{
+    auto const& dfa = detail::dfa<Traits, true>;
+    constexpr std::size_t classes = make_dfa<Traits, true>::classes.count;
+    // Few matches are live at once, usually just the current token's
+    std::vector<std::size_t> live;
+    std::vector<std::size_t> next;
+    auto last = points.empty() ? std::size_t{0} : points.back();
+    auto at = from;
+    auto offset = from;
+    while (offset < source.size())
+    {
+        auto const scanned = scan<Traits>(source.substr(offset));
+        if (scanned.index >= Traits::token_count) break;
+        auto const start = offset + scanned.skipped.length;
+        for (; at < start && !live.empty(); ++at)
+        {
+            auto const cls = dfa.byte_class[static_cast<unsigned char>(source[at])];
+            next.clear();
+            for (auto const q : live)
+            {
+                auto const to = dfa.next[q * classes + cls];
+                if (to != dfa.dead && std::find(next.begin(), next.end(), to) == next.end()) next.push_back(to);
+            }
+            live.swap(next);
+        }
+        at = start;
+        if (live.empty())
+        {
+            if (start >= last + stride)
+            {
+                points.push_back(start);
+                last = start;
+            }
+            if (start >= until) return start;
+        }
+        live.push_back(dfa.start);
+        offset = start + scanned.length;
+    }
+    return std::string_view::npos;
+}
+} // namespace detail
+
+/// Replacement of removed bytes at offset with inserted
+struct Edit
+{
+    std::size_t offset = 0;
+    std::size_t removed = 0;
+    std::string_view inserted;
+};
+
+/// Offsets in a lexed source which no match begun before them reaches, so an edit after one
+/// cannot change the tokens before it. relex sweeps back from an edit only as far as the nearest
+/// of these, without them it may sweep to the start of the source, as states such as those inside
+/// a block comment survive almost any byte read backwards. Points are kept about stride bytes
+/// apart, build them with resync_points and keep them current with apply.
+struct ResyncPoints
+{
+    static constexpr std::size_t default_stride = 4096;
+
+    std::size_t stride = default_stride;
+    std::vector<std::size_t> offsets;
+};
+
+/// Finds the resync points of a lexed source, lexing it once more while stepping every live match
+/// through the DFA
+template <typename Traits, typename T, typename Allocator>
+ResyncPoints resync_points(Lexed<T, Allocator> const& lexed, std::size_t stride = ResyncPoints::default_stride)
+{
+    ResyncPoints points;
+    points.stride = std::max<std::size_t>(stride, 1);
+    detail::find_resync_points<Traits>(lexed.source, 0, std::string_view::npos, points.stride, points.offsets);
+    return points;
+}
+
+/// Change to a token stream after an edit. Old tokens [first, first + removed) are replaced by
+/// inserted, which are lexed against the edited source. Old tokens after that are unchanged apart
+/// from moving by offset_delta bytes and line_delta lines.
+template <typename T>
+struct TokenDiff
+{
+    std::size_t first = 0;
+    std::size_t removed = 0;
+    std::vector<T> inserted;
+    std::ptrdiff_t offset_delta = 0;
+    std::ptrdiff_t line_delta = 0;
+    // Unlexed tail of the edited source
+    std::string_view remainder;
+};
+
+/// Re-lexes only the part of a token stream an edit can have changed. Lexing restarts after the
+/// last token before the edit which no match could have read the edited bytes from, and stops as
+/// soon as a new token starts where an old one did past the edit, as everything after must then
+/// agree. How far a match can read is found with the grammar's DFA with lookaheads dropped, so the
+/// grammar must be one the DFA engine accepts, and lookaheads are assumed to need one byte.
+///
+/// source is the edited text, old must still hold the tokens lexed before the edit, though the
+/// text they viewed may since have been overwritten. points must be those of old, the sweep back
+/// from the edit stops at the last of them before it.
+template <typename Traits, typename T, typename Allocator>
+TokenDiff<T> relex(Lexed<T, Allocator> const& old,
+                   std::string_view source,
+                   Edit const& edit,
+                   ResyncPoints const& points)
+{
+    using tables = detail::tables<Traits>;
+    auto const& dfa = detail::dfa<Traits, true>;
+
+    TokenDiff<T> diff;
+    diff.offset_delta = static_cast<std::ptrdiff_t>(edit.inserted.size()) - static_cast<std::ptrdiff_t>(edit.removed);
+    auto const offset_of = [&](T const& tok) { return detail::token_offset(tok, old.source); };
+    auto const length_of = [&](T const& tok) { return old.lexeme(tok).size(); };
+
+    // Tokens which end at or after the edit are always re-lexed. Before that, a token must be
+    // re-lexed when its match could have read the edited bytes, which is when some pattern is
+    // still live on reaching the edit from where it began. Sweep backwards tracking the set of DFA
+    // states which survive to the edit, any point where the start state is among them may begin
+    // such a match. Once the set is empty no earlier match can reach the edit, nor can one from
+    // before a resync point.
+    auto restart = static_cast<std::size_t>(
+        std::lower_bound(old.tokens.begin(), old.tokens.end(), edit.offset, [&](T const& tok, std::size_t offset) {
+            return offset_of(tok) + length_of(tok) < offset;
+        }) -
+        old.tokens.begin());
+    auto const& reverse = detail::reverse_transitions<Traits>();
+    constexpr std::size_t states = std::tuple_size_v<decltype(dfa.accept)>;
+    constexpr std::size_t words = (states + 63) / 64;
+    std::array<std::uint64_t, words> live{};
+    for (std::size_t q = 0; q < states; ++q)
+    {
+        if (q != dfa.dead) live[q / 64] |= std::uint64_t{1} << (q % 64);
+    }
+    auto const after = std::lower_bound(points.offsets.begin(), points.offsets.end(), edit.offset);
+    auto const floor = after == points.offsets.begin() ? std::size_t{0} : *std::prev(after);
+    for (auto p = edit.offset; p-- > floor;)
+    {
+        auto const cls = dfa.byte_class[static_cast<unsigned char>(source[p])];
+        std::array<std::uint64_t, words> prev{};
+        std::uint64_t any = 0;
+        for (std::size_t w = 0; w < words; ++w)
+        {
+            for (auto bits = live[w]; bits; bits &= bits - 1)
+            {
+                auto const q = w * 64 + static_cast<std::size_t>(__builtin_ctzll(bits));
+                auto const* from = reverse.data() + (cls * states + q) * words;
+                for (std::size_t v = 0; v < words; ++v)
+                {
+                    prev[v] |= from[v];
+                }
+            }
+        }
+        prev[dfa.dead / 64] &= ~(std::uint64_t{1} << (dfa.dead % 64));
+        for (std::size_t w = 0; w < words; ++w)
+        {
+            any |= prev[w];
+        }
+        if (!any) break;
+        live = prev;
+        if (live[dfa.start / 64] >> (dfa.start % 64) & 1)
+        {
+            // A match may begin at p, keep only the tokens which end by then
+            while (restart > 0 && offset_of(old.tokens[restart - 1]) + length_of(old.tokens[restart - 1]) > p)
+            {
+                --restart;
+            }
+        }
+    }
+    diff.first = restart;
+
+    // Re-lex from the end of the restart token until a token lines up with an old one
+    std::size_t offset = 0;
+    std::size_t line = 0;
+    if (restart > 0)
+    {
+        auto const& before = old.tokens[restart - 1];
+        offset = offset_of(before) + length_of(before);
+        line = old.first_line(before) + old.num_lines(before);
+    }
+    auto const edit_end = edit.offset + edit.inserted.size();
+    auto stop = old.tokens.size();
+    while (offset < source.size())
+    {
+        auto const scanned = detail::scan<Traits>(source.substr(offset));
+        if (scanned.index >= Traits::token_count) break;
+        auto const start = offset + scanned.skipped.length;
+        auto const lexeme = source.substr(start, scanned.length);
+        auto const first_line = line + scanned.skipped.lines;
+        auto const num_lines = static_cast<std::size_t>(std::count(lexeme.begin(), lexeme.end(), '\n'));
+        if (start >= edit_end && !tables::filtered[scanned.index])
+        {
+            // Past the edit the sources agree, so a token starting where an old one did is the same
+            // token, as is all that follows
+            auto const old_start = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(start) - diff.offset_delta);
+            auto const found = std::lower_bound(
+                old.tokens.begin() + static_cast<std::ptrdiff_t>(restart),
+                old.tokens.end(),
+                old_start,
+                [&](T const& tok, std::size_t at) { return offset_of(tok) < at; });
+            if (found != old.tokens.end() && offset_of(*found) == old_start)
+            {
+                // The old text may be gone, so lines moved are found from the token rather than
+                // by counting the removed newlines
+                stop = static_cast<std::size_t>(found - old.tokens.begin());
+                diff.line_delta = static_cast<std::ptrdiff_t>(first_line) - static_cast<std::ptrdiff_t>(old.first_line(*found));
+                offset = static_cast<std::size_t>(
+                    static_cast<std::ptrdiff_t>(old.source.size() - old.remainder.size()) + diff.offset_delta);
+                break;
+            }
+        }
+        offset = start + scanned.length;
+        line = first_line + num_lines;
+        if (tables::filtered[scanned.index]) continue;
+        if constexpr (detail::is_compact_token<T>::value)
+        {
+            diff.inserted.push_back(
+                T{static_cast<std::uint32_t>(start), static_cast<std::uint32_t>(scanned.length), tables::types[scanned.index]});
+        }
+        else
+        {
+            diff.inserted.push_back(T{tables::types[scanned.index], lexeme, first_line, num_lines});
+        }
+    }
+    diff.removed = stop - restart;
+    diff.remainder = source.substr(offset);
+    return diff;
+}
+
+/// Re-lexes after an edit without resync points, so the sweep back from the edit may run to the
+/// start of the source
+template <typename Traits, typename T, typename Allocator>
+TokenDiff<T> relex(Lexed<T, Allocator> const& old, std::string_view source, Edit const& edit)
+{
+    return relex<Traits>(old, source, edit, ResyncPoints{});
+}
+
+/// Applies a diff from relex, moving the token stream over to the edited source. Kept tokens are
+/// moved and a compact token newline index rebuilt, both linear but cheap next to lexing.
+template <typename T, typename Allocator>
+void apply(Lexed<T, Allocator>& lexed, std::string_view source, TokenDiff<T> const& diff)
+{
+    auto& tokens = lexed.tokens;
+    auto const first = tokens.begin() + static_cast<std::ptrdiff_t>(diff.first);
+    auto const last = first + static_cast<std::ptrdiff_t>(diff.removed);
+    // Full tokens view the source, so the kept head must move over to the new one as well
+    if constexpr (!detail::is_compact_token<T>::value)
+    {
+        for (auto it = tokens.begin(); it != first; ++it)
+        {
+            it->lexeme = source.substr(lexed.offset(*it), it->lexeme.size());
+        }
+    }
+    // The kept tail moves by the size of the edit
+    for (auto it = last; it != tokens.end(); ++it)
+    {
+        auto const offset = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(lexed.offset(*it)) + diff.offset_delta);
+        if constexpr (detail::is_compact_token<T>::value)
+        {
+            it->offset = static_cast<std::uint32_t>(offset);
+        }
+        else
+        {
+            it->lexeme = source.substr(offset, it->lexeme.size());
+            it->first_line = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(it->first_line) + diff.line_delta);
+        }
+    }
+    auto const tail = tokens.erase(first, last);
+    tokens.insert(tail, diff.inserted.begin(), diff.inserted.end());
+    lexed.source = source;
+    lexed.remainder = diff.remainder;
+    if constexpr (detail::is_compact_token<T>::value)
+    {
+        lexed.lines = typename Lexed<T, Allocator>::line_index_t(source, lexed.lines.bits.get_allocator());
+    }
+}
+
+/// Applies a diff from relex and updates the resync points to match. Points before the re-lexed
+/// tokens are kept, new ones are found from there until a point past them, after which the old
+/// ones still hold, moved by the size of the edit.
+template <typename Traits, typename T, typename Allocator>
+void apply(Lexed<T, Allocator>& lexed, std::string_view source, TokenDiff<T> const& diff, ResyncPoints& points)
+{
+    apply(lexed, source, diff);
+    auto const& tokens = lexed.tokens;
+    std::size_t restart = 0;
+    if (diff.first > 0) restart = lexed.offset(tokens[diff.first - 1]) + lexed.lexeme(tokens[diff.first - 1]).size();
+    // Past the first unchanged token the sources lex alike, so once no match is live the old
+    // points are good again
+    auto const synced = diff.first + diff.inserted.size();
+    auto const until = synced < tokens.size() ? lexed.offset(tokens[synced]) : std::string_view::npos;
+
+    auto& offsets = points.offsets;
+    auto const head = std::upper_bound(offsets.begin(), offsets.end(), restart);
+    std::vector<std::size_t> const tail(head, offsets.end());
+    offsets.erase(head, offsets.end());
+    auto const from = offsets.empty() ? std::size_t{0} : offsets.back();
+    auto const resynced = detail::find_resync_points<Traits>(source, from, until, points.stride, offsets);
+    if (resynced == std::string_view::npos) return;
+    for (auto const offset : tail)
+    {
+        auto const moved = static_cast<std::ptrdiff_t>(offset) + diff.offset_delta;
+        if (moved > static_cast<std::ptrdiff_t>(resynced)) offsets.push_back(static_cast<std::size_t>(moved));
+    }
+}
+} // namespace REGLEX_NAMESPACE
+
+#endif // REGLEX_INCREMENTAL_H
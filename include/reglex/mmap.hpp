@@ -0,0 +1,115 @@
+#pragma once
+#if !defined(REGLEX_MMAP_H)
+#define REGLEX_MMAP_H
+
+#if !defined(REGLEX_NAMESPACE)
+#define REGLEX_NAMESPACE reglex
+#endif
+
+#include <cerrno>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace REGLEX_NAMESPACE
+{
+/// Read only view of a whole file, mapped into memory so that it can be lexed without a copy. The
+/// kernel is told the mapping will be read sequentially. Anything which can't be mapped, such as a
+/// pipe, is read into an owned buffer instead.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(char const* path)
+    {
+        auto const fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return;
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+        {
+            auto const size = static_cast<std::size_t>(info.st_size);
+            auto const addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED)
+            {
+                ::madvise(addr, size, MADV_SEQUENTIAL);
+                map_ = addr;
+                view_ = {static_cast<char const*>(addr), size};
+                open_ = true;
+            }
+        }
+        if (!open_) open_ = read_all(fd);
+        ::close(fd);
+    }
+
+    explicit MappedFile(std::string const& path) : MappedFile(path.c_str()) {}
+
+    MappedFile(MappedFile&& other) noexcept { swap(other); }
+
+    MappedFile& operator=(MappedFile&& other) noexcept
+    {
+        MappedFile tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    ~MappedFile()
+    {
+        if (map_) ::munmap(map_, view_.size());
+    }
+
+    bool is_open() const noexcept { return open_; }
+    /// True when the contents are mapped rather than read into a buffer
+    bool is_mapped() const noexcept { return map_ != nullptr; }
+
+    std::string_view view() const noexcept { return view_; }
+    operator std::string_view() const noexcept { return view_; }
+
+    void swap(MappedFile& other) noexcept
+    {
+        std::swap(map_, other.map_);
+        std::swap(open_, other.open_);
+        // The view may point into the small string buffer, so it is rebuilt after the swap
+        std::swap(buffer_, other.buffer_);
+        std::swap(view_, other.view_);
+        if (!map_) view_ = buffer_;
+        if (!other.map_) other.view_ = other.buffer_;
+    }
+
+private:
+    // Fallback for files which can't be mapped, returns false on a read error
+    bool read_all(int fd)
+    {
+        char chunk[1 << 16];
+        for (;;)
+        {
+            auto const n = ::read(fd, chunk, sizeof(chunk));
+            if (n == 0) break;
+            if (n < 0)
+            {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            buffer_.append(chunk, static_cast<std::size_t>(n));
+        }
+        view_ = buffer_;
+        return true;
+    }
+
+    void* map_ = nullptr;
+    std::string buffer_;
+    std::string_view view_;
+    bool open_ = false;
+};
+} // namespace REGLEX_NAMESPACE
+
+#endif // REGLEX_MMAP_H
@@ -0,0 +1,253 @@
+#pragma once
+#if !defined(REGLEX_PARALLEL_H)
+#define REGLEX_PARALLEL_H
+
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <reglex/reglex.hpp>
+
+namespace REGLEX_NAMESPACE
+{
+namespace detail
+{
+// Sources smaller than this per thread aren't worth splitting
+static constexpr std::size_t parallel_min_chunk = std::size_t{1} << 16;
+
+// Calls f(i) for every i in [0, n), each on its own thread, the last on the calling thread. Every
+// thread is joined before an exception thrown by f, or by starting a thread, is rethrown.
+template <typename F>
+void run_parallel(std::size_t n, F const& f)
+{
+    std::vector<std::thread> workers;
+    workers.reserve(n);
+    std::mutex mutex;
+    std::exception_ptr error;
+    auto const run = [&](std::size_t i) {
+        try
+        {
+            f(i);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) error = std::current_exception();
+        }
+    };
+    try
+    {
+        for (std::size_t i = 0; i + 1 < n; ++i)
+        {
+            workers.emplace_back(run, i);
+        }
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) error = std::current_exception();
+    }
+    if (n && workers.size() + 1 == n) run(n - 1);
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+// Builds the newline index with each thread covering a run of whole blocks. Each block count is
+// first relative to the start of its run, then a prefix sum over the run totals fixes them up.
+inline LineIndex parallel_line_index(std::string_view source, std::size_t threads)
+{
+    LineIndex index;
+    index.bits.resize(source.size() / 64 + 1);
+    index.blocks.resize(index.bits.size() / LineIndex::words_per_block + 1);
+    auto const block_count = (index.bits.size() + LineIndex::words_per_block - 1) / LineIndex::words_per_block;
+    std::vector<std::size_t> totals(threads);
+    run_parallel(threads, [&](std::size_t t) {
+        auto const first_block = block_count * t / threads;
+        auto const last_block = block_count * (t + 1) / threads;
+        auto const first_word = first_block * LineIndex::words_per_block;
+        auto const last_word = std::min(last_block * LineIndex::words_per_block, index.bits.size());
+        auto const first_byte = std::min(first_word * 64, source.size());
+        auto const last_byte = std::min(last_word * 64, source.size());
+        simd::newline_masks(source.data() + first_byte, last_byte - first_byte, index.bits.data() + first_word);
+        std::size_t count = 0;
+        for (auto w = first_word; w < last_word; ++w)
+        {
+            if (w % LineIndex::words_per_block == 0) index.blocks[w / LineIndex::words_per_block] = count;
+            count += static_cast<std::size_t>(__builtin_popcountll(index.bits[w]));
+        }
+        totals[t] = count;
+    });
+    std::size_t carry = 0;
+    for (std::size_t t = 0; t < threads; ++t)
+    {
+        auto const first_block = block_count * t / threads;
+        auto const last_block = block_count * (t + 1) / threads;
+        for (auto b = first_block; b < last_block; ++b)
+        {
+            index.blocks[b] += carry;
+        }
+        carry += totals[t];
+    }
+    return index;
+}
+
+// Tokens lexed for one chunk, on the guess that the chunk begins on a token boundary
+template <typename T>
+struct Chunk
+{
+    std::size_t begin;
+    std::size_t end;
+    std::vector<T> tokens;
+    LexStop stop;
+    // Set while stitching, the first speculative token kept and any re-lexed tokens before it, and
+    // the line the kept tokens were really lexed from, as full token lines count from the chunk
+    std::size_t first = 0;
+    std::vector<T> fixed;
+    std::size_t line = 0;
+};
+
+// Splits a source into count chunks, each ending just after the first newline at or beyond an even
+// division of the source
+template <typename T>
+std::vector<Chunk<T>> split_chunks(std::string_view source, std::size_t count)
+{
+    std::vector<Chunk<T>> chunks(count);
+    std::size_t begin = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto end = source.size();
+        if (i + 1 < count)
+        {
+            auto const target = std::max(begin, source.size() * (i + 1) / count);
+            auto const newline = source.find('\n', target);
+            end = newline == std::string_view::npos ? source.size() : newline + 1;
+        }
+        chunks[i].begin = begin;
+        chunks[i].end = end;
+        begin = end;
+    }
+    return chunks;
+}
+
+template <typename Traits, typename T>
+void lex_chunk(std::string_view source, Chunk<T>& chunk)
+{
+    // Tokens per byte vary too much between sources for a reservation to be worth it, comments
+    // and strings hold many bytes each
+    chunk.stop = lex_until<Traits>(source, chunk.begin, chunk.end, 0, chunk.tokens);
+}
+
+// Walks the lexed chunks in order, checking each started where the previous one stopped, then
+// gathers the kept tokens into res
+template <typename Traits, typename T>
+void stitch_chunks(Lexed<T>& res, std::vector<Chunk<T>>& chunks)
+{
+    auto const source = res.source;
+    LexStop stop{0, false};
+    std::size_t used = 0;
+    for (; used < chunks.size() && !stop.failed; ++used)
+    {
+        auto& chunk = chunks[used];
+        if (stop.offset == chunk.begin)
+        {
+            chunk.line = stop.line;
+            stop = chunk.stop;
+            stop.line += chunk.line;
+            continue;
+        }
+        // A token ran over the whole chunk
+        chunk.first = chunk.tokens.size();
+        if (stop.offset >= chunk.end) continue;
+        // Re-lex a step at a time until a token lines up with a speculative one, from which point
+        // the two must agree
+        auto& out = chunk.fixed;
+        while (stop.offset < chunk.end && !stop.failed)
+        {
+            auto const before = out.size();
+            auto const from = stop.offset;
+            auto const next = from + Traits::skip_t::skip(source.substr(from)).length;
+            stop = lex_until<Traits>(source, from, next + 1, stop.line, out);
+            // Only trivia is left, which ends the source
+            if (stop.offset == from) break;
+            if (out.size() == before) continue;
+            auto const start = token_offset(out.back(), source);
+            auto const found = std::lower_bound(
+                chunk.tokens.begin(), chunk.tokens.end(), start, [&](T const& tok, std::size_t offset) {
+                    return token_offset(tok, source) < offset;
+                });
+            if (found != chunk.tokens.end() && token_offset(*found, source) == start)
+            {
+                if constexpr (!is_compact_token<T>::value) chunk.line = out.back().first_line - found->first_line;
+                out.pop_back();
+                chunk.first = static_cast<std::size_t>(found - chunk.tokens.begin());
+                stop = chunk.stop;
+                stop.line += chunk.line;
+                break;
+            }
+        }
+    }
+
+    // Reserving the whole result only takes address space until it is written, so appending the
+    // chunks in order and releasing each once copied keeps memory to about one chunk over the
+    // result, rather than twice it
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < used; ++i)
+    {
+        total += chunks[i].fixed.size() + chunks[i].tokens.size() - chunks[i].first;
+    }
+    res.tokens.reserve(total);
+    for (std::size_t i = 0; i < used; ++i)
+    {
+        auto& chunk = chunks[i];
+        res.tokens.insert(res.tokens.end(), chunk.fixed.begin(), chunk.fixed.end());
+        auto const kept = res.tokens.size();
+        res.tokens.insert(res.tokens.end(), chunk.tokens.begin() + static_cast<std::ptrdiff_t>(chunk.first), chunk.tokens.end());
+        if constexpr (!is_compact_token<T>::value)
+        {
+            for (auto k = kept; k < res.tokens.size(); ++k)
+            {
+                res.tokens[k].first_line += chunk.line;
+            }
+        }
+        std::vector<T>().swap(chunk.tokens);
+        std::vector<T>().swap(chunk.fixed);
+    }
+    res.remainder = source.substr(stop.offset);
+}
+} // namespace detail
+
+/// Lexes one large source across threads, with the same result as lex. The source is split after
+/// newlines and every chunk is lexed speculatively from its start, up to the first token which
+/// begins in the next. A chunk is then kept when the previous one stopped exactly at its start,
+/// which it does unless a token crosses the split. Trivia must skip the same when split after a
+/// newline, as whitespace does. When a comment or string crossed the split, the
+/// chunk is re-lexed from where the previous one really stopped, until it falls back in step with
+/// the speculative tokens, which are then kept. Full token lines are counted from the start of
+/// their chunk and moved by the line it turns out to begin on. With threads of zero the hardware
+/// concurrency is used.
+template <typename Traits>
+Lexed<typename Traits::token_t> parallel_lex(std::string_view source, std::size_t threads = 0)
+{
+    using token_t = typename Traits::token_t;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, std::max<std::size_t>(1, source.size() / detail::parallel_min_chunk));
+    if (threads == 1) return lex<Traits>(source);
+
+    Lexed<token_t> res;
+    res.source = source;
+    // Compact tokens resolve their lines through the index, which is built in parallel as well
+    if constexpr (detail::is_compact_token<token_t>::value) res.lines = detail::parallel_line_index(source, threads);
+    auto chunks = detail::split_chunks<token_t>(source, threads);
+    detail::run_parallel(threads, [&](std::size_t i) { detail::lex_chunk<Traits>(source, chunks[i]); });
+    detail::stitch_chunks<Traits>(res, chunks);
+    return res;
+}
+} // namespace REGLEX_NAMESPACE
+
+#endif // REGLEX_PARALLEL_H
@@ -0,0 +1,205 @@
+#pragma once
+#if !defined(REGLEX_POOL_H)
+#define REGLEX_POOL_H
+
+#if !defined(REGLEX_NAMESPACE)
+#define REGLEX_NAMESPACE reglex
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace REGLEX_NAMESPACE
+{
+namespace detail
+{
+/// Fixed set of workers, each with its own task queue. Tasks submitted from a worker go on its own
+/// queue and are taken newest first, an idle worker steals the oldest task from another queue. This
+/// keeps the tasks a job splits into close to the worker that made them, while big jobs still
+/// spread across the machine.
+///
+/// A task which throws doesn't take its worker down, the first exception is kept and rethrown by
+/// wait once every task has run.
+class work_stealing_pool
+{
+public:
+    using task_t = std::function<void()>;
+
+    explicit work_stealing_pool(std::size_t threads)
+    {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        for (std::size_t i = 0; i < threads; ++i)
+        {
+            queues_.push_back(std::make_unique<queue>());
+        }
+        workers_.reserve(threads);
+        try
+        {
+            for (std::size_t i = 0; i < threads; ++i)
+            {
+                workers_.emplace_back([this, i] { work(i); });
+            }
+        }
+        catch (...)
+        {
+            // A running thread must be joined before it is destroyed
+            stop();
+            throw;
+        }
+    }
+
+    work_stealing_pool(work_stealing_pool const&) = delete;
+    work_stealing_pool& operator=(work_stealing_pool const&) = delete;
+
+    ~work_stealing_pool() { stop(); }
+
+    std::size_t size() const noexcept { return workers_.size(); }
+
+    void submit(task_t task)
+    {
+        pending_.fetch_add(1);
+        auto const target = current_pool == this ? current_index : next_.fetch_add(1) % queues_.size();
+        // Counted before it is queued, so a worker never sees the count drop below zero
+        {
+            std::lock_guard<std::mutex> lock(idle_mutex_);
+            ++queued_;
+        }
+        try
+        {
+            std::lock_guard<std::mutex> lock(queues_[target]->mutex);
+            queues_[target]->tasks.push_back(std::move(task));
+        }
+        catch (...)
+        {
+            {
+                std::lock_guard<std::mutex> lock(idle_mutex_);
+                --queued_;
+            }
+            finish();
+            throw;
+        }
+        idle_.notify_one();
+    }
+
+    /// Blocks until every submitted task, and any they submitted, has run. Rethrows the first
+    /// exception a task threw, after which the pool can be used again.
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(done_mutex_);
+        done_.wait(lock, [this] { return pending_.load() == 0; });
+        if (error_) std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+
+private:
+    struct queue
+    {
+        std::mutex mutex;
+        std::deque<task_t> tasks;
+    };
+
+    // Lets the workers finish what is queued, then joins them
+    void stop() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(idle_mutex_);
+            stop_ = true;
+        }
+        idle_.notify_all();
+        for (auto& worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+    // Counts a task as done, waking wait on the last
+    void finish()
+    {
+        if (pending_.fetch_sub(1) == 1)
+        {
+            std::lock_guard<std::mutex> lock(done_mutex_);
+            done_.notify_all();
+        }
+    }
+
+    // Takes the newest task of our own queue, or else the oldest of another
+    bool take(std::size_t self, task_t& task)
+    {
+        for (std::size_t k = 0; k < queues_.size(); ++k)
+        {
+            auto& q = *queues_[(self + k) % queues_.size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.tasks.empty()) continue;
+            if (k == 0)
+            {
+                task = std::move(q.tasks.back());
+                q.tasks.pop_back();
+            }
+            else
+            {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+            }
+            --queued_;
+            return true;
+        }
+        return false;
+    }
+
+    void work(std::size_t self)
+    {
+        current_pool = this;
+        current_index = self;
+        for (;;)
+        {
+            task_t task;
+            if (!take(self, task))
+            {
+                std::unique_lock<std::mutex> lock(idle_mutex_);
+                idle_.wait(lock, [this] { return stop_ || queued_.load() != 0; });
+                if (stop_ && queued_.load() == 0) return;
+                continue;
+            }
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(done_mutex_);
+                if (!error_) error_ = std::current_exception();
+            }
+            finish();
+        }
+    }
+
+    static inline thread_local work_stealing_pool* current_pool = nullptr;
+    static inline thread_local std::size_t current_index = 0;
+
+    std::vector<std::unique_ptr<queue>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<std::size_t> next_{0};
+    // Tasks sitting in a queue, and tasks submitted but not yet finished
+    std::atomic<std::size_t> queued_{0};
+    std::atomic<std::size_t> pending_{0};
+    bool stop_ = false;
+    std::mutex idle_mutex_;
+    std::condition_variable idle_;
+    std::mutex done_mutex_;
+    std::condition_variable done_;
+    // First exception thrown by a task, guarded by done_mutex_
+    std::exception_ptr error_;
+};
+} // namespace detail
+} // namespace REGLEX_NAMESPACE
+
+#endif // REGLEX_POOL_H
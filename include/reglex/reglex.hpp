@@ -6,15 +6,23 @@
 #define REGLEX_NAMESPACE reglex
 #endif
 
+#include <algorithm>
 #include <array>
+#include <cstdint>
 #include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
 #include <optional>
 #include <string_view>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 #include <magic_enum.hpp>
 #include <ctre/ctre.hpp>
+#include <reglex/simd.hpp>
 
 namespace REGLEX_NAMESPACE
 {
@@ -25,6 +33,12 @@ struct Matcher
     static constexpr std::string_view pattern = "";
     template <TokenT>
     static constexpr bool filter_out = false;
+    // Keyword tokens give their spelling instead of a pattern
+    template <TokenT>
+    static constexpr std::string_view keyword = "";
+    // Matches of these tokens are looked up in the keyword table, and take the keywords type if found
+    template <TokenT>
+    static constexpr bool has_keywords = false;
 };
 
 template <typename TokenType>
@@ -37,12 +51,163 @@ struct Token
     std::size_t num_lines;
 };
 
+/// Token layout which stores only where its lexeme lies in the source, 12 bytes rather than 40.
+/// Lexemes and line numbers are recovered through the owning Lexed. Opt in by setting token_t in
+/// the traits, sources are limited to 4GiB.
+template <typename TokenType>
+struct CompactToken
+{
+    using token_type_t = TokenType;
+    std::uint32_t offset;
+    std::uint32_t length;
+    token_type_t type;
+};
+
+namespace detail
+{
+// Rank query over a newline bit set and its per block counts, however they are stored
+template <std::size_t WordsPerBlock, typename Count>
+std::size_t newlines_before(std::uint64_t const* bits, Count const* blocks, std::size_t offset) noexcept
+{
+    auto const word = offset / 64;
+    auto count = static_cast<std::size_t>(blocks[word / WordsPerBlock]);
+    for (auto w = word - word % WordsPerBlock; w < word; ++w)
+    {
+        count += static_cast<std::size_t>(__builtin_popcountll(bits[w]));
+    }
+    auto const below = (std::uint64_t{1} << (offset % 64)) - 1;
+    return count + static_cast<std::size_t>(__builtin_popcountll(bits[word] & below));
+}
+} // namespace detail
+
+/// Newline bitmap over a source buffer, with prefix counts so that the line of any offset is found
+/// in constant time. Built with one vectorized pass. Storage comes from Allocator, rebound to each
+/// array's element type.
+template <typename Allocator = std::allocator<std::uint64_t>>
+struct BasicLineIndex
+{
+    using allocator_type = Allocator;
+    using word_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<std::uint64_t>;
+    using count_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<std::size_t>;
+
+    // Bit i of word w is set when byte w * 64 + i is a newline
+    std::vector<std::uint64_t, word_allocator> bits;
+    // Newlines before each group of words_per_block words
+    std::vector<std::size_t, count_allocator> blocks;
+
+    static constexpr std::size_t words_per_block = 8;
+
+    BasicLineIndex() = default;
+
+    explicit BasicLineIndex(Allocator const& alloc) : bits(word_allocator(alloc)), blocks(count_allocator(alloc)) {}
+
+    explicit BasicLineIndex(std::string_view source, Allocator const& alloc = Allocator())
+        // Keep a trailing word, so that the end offset can be looked up
+        : bits(source.size() / 64 + 1, word_allocator(alloc))
+        , blocks(bits.size() / words_per_block + 1, count_allocator(alloc))
+    {
+        detail::simd::newline_masks(source.data(), source.size(), bits.data());
+        std::size_t count = 0;
+        for (std::size_t w = 0; w < bits.size(); ++w)
+        {
+            if (w % words_per_block == 0) blocks[w / words_per_block] = count;
+            count += static_cast<std::size_t>(__builtin_popcountll(bits[w]));
+        }
+    }
+
+    /// Number of newlines before offset, which is the zero based line it lies on
+    std::size_t line_of(std::size_t offset) const noexcept
+    {
+        return detail::newlines_before<words_per_block>(bits.data(), blocks.data(), offset);
+    }
+
+    /// Number of newlines in the range [first, last)
+    std::size_t lines_between(std::size_t first, std::size_t last) const noexcept
+    {
+        return line_of(last) - line_of(first);
+    }
+};
+
+using LineIndex = BasicLineIndex<>;
+
+/// Result of skipping trivia ahead of a token
+struct Skipped
+{
+    std::size_t length = 0;
+    std::size_t lines = 0;
+};
+
+/// Skip policy which consumes nothing, every character must be matched by a token pattern
+struct skip_none
+{
+    static constexpr Skipped skip(std::string_view) noexcept { return {}; }
+};
+
+/// Skip policy which consumes ASCII whitespace, counting the newlines passed. Runs of whitespace
+/// are scanned a vector at a time when SSE2 or AVX2 is available.
+struct skip_whitespace
+{
+    static constexpr bool is_space(char c) noexcept
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+    }
+
+    static constexpr Skipped skip(std::string_view src) noexcept
+    {
+        Skipped res;
+        // Most tokens are directly adjacent to the previous one
+        if (src.empty() || !is_space(src.front())) return res;
+        if (!REGLEX_IS_CONSTANT_EVALUATED())
+        {
+            res.length = detail::simd::skip_whitespace(src.data(), src.size(), res.lines);
+            return res;
+        }
+        for (; res.length < src.size() && is_space(src[res.length]); ++res.length)
+        {
+            res.lines += src[res.length] == '\n';
+        }
+        return res;
+    }
+};
+
+/// Result of matching the grammar at the start of the input, index is the matching alternative in
+/// enum order, or token_count if nothing matched
+struct Match
+{
+    std::size_t index;
+    std::size_t length;
+};
+
+/// Matching engine with a CTRE matcher per pattern. The first byte picks the patterns which can
+/// begin there, single byte tokens are decided from it alone, and the rest are tried in enum order.
+/// The first to match wins, or with longest_match set the longest, ties going to the earlier.
+struct regex_engine;
+
+/// Instrumentation policy which records nothing. Every hook is behind a check of enabled, so no code
+/// is emitted for it. See count_stats in <reglex/stats.hpp> for one which does.
+struct no_stats
+{
+    static constexpr bool enabled = false;
+};
+
+/// Policies can be replaced by deriving from LexTraits and shadowing the relevant member
 template <typename TokenT, typename Matcher>
 struct LexTraits
 {
     using token_type_t = TokenT;
     using token_t = Token<token_type_t>;
     using matcher_t = Matcher;
+    // Trivia consumed before every token attempt, token patterns are anchored after it
+    using skip_t = skip_whitespace;
+    // Engine used to match the token patterns
+    using engine_t = regex_engine;
+    // Instrumentation of the lexing hot path
+    using stats_t = no_stats;
+    // Pick the longest matching pattern, ties go to the earliest enumerator. Otherwise the first
+    // matching pattern in enum order wins. The DFA engine always picks the longest match.
+    static constexpr bool longest_match = false;
+    // Upper bound on intermediate states while the DFA engine builds its table
+    static constexpr std::size_t dfa_max_states = 1024;
 
     template <std::size_t J>
     static constexpr token_type_t lookup = magic_enum::enum_value<token_type_t>(J);
@@ -51,65 +216,278 @@ struct LexTraits
 
 namespace detail
 {
+template <typename Traits, std::size_t I>
+struct make_token_pattern
+{
+    static constexpr auto impl() noexcept
+    {
+        constexpr auto src = Traits::matcher_t::template pattern<Traits::template lookup<I>>;
+        // Include space for the null terminator
+        char arr[src.size() + 1]{};
+        for (std::size_t i = 0; i < src.size(); ++i)
+        {
+            arr[i] = src[i];
+        }
+        return ctll::fixed_string{arr};
+    }
+};
+
+// Pattern for a single token, each alternative of the grammar is evaluated independently
+template <typename Traits, std::size_t I>
+static constexpr ctll::fixed_string token_pattern = make_token_pattern<Traits, I>::impl();
+
+// Matches a single token pattern anchored at the start of the input
+template <typename Traits, std::size_t I>
+constexpr Match match_pattern(std::string_view src) noexcept
+{
+    auto const match = ctre::starts_with<token_pattern<Traits, I>>(src);
+    return match ? Match{I, match.size()} : Match{Traits::token_count, 0};
+}
+
+// Bytes which can begin a match of a token pattern, from CTRE's first character analysis
+template <typename Traits, std::size_t I>
+constexpr std::array<bool, 256> first_bytes() noexcept
+{
+    using regex_t = typename ctre::regex_builder<token_pattern<Traits, I>>::type;
+    constexpr auto first = ctre::calculate_first(regex_t{});
+    ctre::point_set<ctre::calculate_size_of_first(first)> set;
+    set.populate(first);
+    std::array<bool, 256> bytes{};
+    for (std::size_t b = 0; b < bytes.size(); ++b)
+    {
+        // CTRE compares against the (possibly signed) char value
+        auto const c = static_cast<std::int64_t>(static_cast<char>(b));
+        bytes[b] = set.check(c, c);
+    }
+    return bytes;
+}
+
+// True when a token pattern is a single character class, so a match is always one byte long
+template <typename Traits, std::size_t I>
+static constexpr bool single_byte =
+    ctre::MatchesCharacter<typename ctre::regex_builder<token_pattern<Traits, I>>::type>::template value<char>;
+
 template <typename, typename>
-struct make_pattern;
+struct make_dispatch;
 
 template <typename Traits, std::size_t... I>
-struct make_pattern<Traits, std::index_sequence<I...>>
+struct make_dispatch<Traits, std::index_sequence<I...>>
 {
-    using token_type_t = typename Traits::token_type_t;
-    using matcher_t = typename Traits::matcher_t;
+    static constexpr std::size_t words = (Traits::token_count + 63) / 64;
 
-    static constexpr auto impl() noexcept
+    struct table
+    {
+        // Bit mask of the tokens which may begin with each byte
+        std::array<std::array<std::uint64_t, words>, 256> candidates{};
+        // Token which is known to win for each byte without evaluating any pattern, or token_count
+        std::array<std::size_t, 256> direct{};
+    };
+
+    static constexpr std::array<Match (*)(std::string_view), Traits::token_count> matchers{
+        &match_pattern<Traits, I>...};
+
+    static constexpr table impl() noexcept
     {
-        constexpr char delim = '|';
-        constexpr char group_open = '(';
-        constexpr char group_close = ')';
-        constexpr char terminate = '\0';
-        // An open/close and delimiter for each group. The final delimiter gets replaced by a null
-        // terminator
-        constexpr std::size_t len =
-            (Traits::token_count * 3) +
-            (matcher_t::template pattern<Traits::template lookup<I>>.size() + ...);
-        // Temp array
-        char arr[len]{};
-        // Append a new pattern
-        auto append = [i = 0, &arr](auto const& s) mutable {
-            arr[i++] = group_open;
-            for (auto c : s)
+        constexpr std::array<std::array<bool, 256>, Traits::token_count> firsts{first_bytes<Traits, I>()...};
+        constexpr std::array<bool, Traits::token_count> single{single_byte<Traits, I>...};
+        table out{};
+        for (std::size_t b = 0; b < 256; ++b)
+        {
+            auto first = Traits::token_count;
+            bool all_single = true;
+            for (std::size_t i = 0; i < Traits::token_count; ++i)
             {
-                arr[i++] = c;
+                if (!firsts[i][b]) continue;
+                out.candidates[b][i / 64] |= std::uint64_t{1} << (i % 64);
+                first = std::min(first, i);
+                all_single = all_single && single[i];
             }
-            arr[i++] = group_close;
-            arr[i++] = delim;
-        };
-        // Append every enums pattern
-        (append(matcher_t::template pattern<Traits::template lookup<I>>), ...);
-        // Set the final char to a null terminator
-        arr[len - 1] = terminate;
-        return ctll::fixed_string{arr};
+            // A single byte pattern always matches its own first bytes. It wins outright when it is
+            // tried first, or under longest match when no other candidate can be longer.
+            bool const decided = first < Traits::token_count && single[first] && (!Traits::longest_match || all_single);
+            out.direct[b] = decided ? first : Traits::token_count;
+        }
+        return out;
     }
 };
 
-// Final pattern stored in the fixed_string type for CTRE
+// First byte dispatch table for a grammar, built once per traits type
+template <typename Traits>
+using dispatch = make_dispatch<Traits, std::make_index_sequence<Traits::token_count>>;
+
 template <typename Traits>
-static constexpr ctll::fixed_string pattern =
-    make_pattern<Traits, std::make_index_sequence<Traits::token_count>>::impl();
+static constexpr auto dispatch_table = dispatch<Traits>::impl();
+
+template <typename, typename>
+struct make_tables;
 
-// Utility for static for loops with a compile time index
-template <typename F, std::size_t... I>
-constexpr void for_n(F&& f, std::index_sequence<I...>)
+template <typename Traits, std::size_t... I>
+struct make_tables<Traits, std::index_sequence<I...>>
 {
-    (std::invoke(std::forward<F>(f), std::integral_constant<std::size_t, I>{}), ...);
-}
+    using token_type_t = typename Traits::token_type_t;
+    using matcher_t = typename Traits::matcher_t;
+
+    static constexpr std::array<token_type_t, Traits::token_count> types{Traits::template lookup<I>...};
+    static constexpr std::array<bool, Traits::token_count> filtered{
+        matcher_t::template filter_out<Traits::template lookup<I>>...};
+    static constexpr std::array<bool, Traits::token_count> has_keywords{
+        matcher_t::template has_keywords<Traits::template lookup<I>>...};
+    static constexpr std::array<std::string_view, Traits::token_count> keywords{
+        matcher_t::template keyword<Traits::template lookup<I>>...};
+};
+
+// Per alternative token type and filter tables, indexed by the engines match index
+template <typename Traits>
+using tables = make_tables<Traits, std::make_index_sequence<Traits::token_count>>;
 
-template <std::size_t N, typename F>
-constexpr void for_n(F&& f)
+constexpr std::uint32_t keyword_hash(std::string_view s, std::uint32_t seed) noexcept
 {
-    for_n(std::forward<F>(f), std::make_index_sequence<N>{});
+    std::uint32_t h = seed ^ static_cast<std::uint32_t>(s.size());
+    for (auto c : s)
+    {
+        h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    return h ^ (h >> 16);
 }
+
+// Called when no perfect hash could be found for the keywords, deliberately not constexpr so the
+// build fails with its name in the diagnostic
+inline void keyword_hash_not_found() {}
+
+template <typename Traits>
+struct make_keywords
+{
+    static constexpr auto const& spellings = tables<Traits>::keywords;
+    static constexpr std::size_t none = Traits::token_count;
+
+    struct shape
+    {
+        std::size_t count = 0;
+        std::size_t min_length = ~std::size_t{0};
+        std::size_t max_length = 0;
+        std::size_t size = 1;
+        std::uint32_t seed = 0;
+    };
+
+    // Searches for a seed which maps every keyword to its own slot. A few seeds are tried at each
+    // table size before doubling it, as collisions become unlikely once the table is large relative
+    // to the square of the keyword count.
+    static constexpr shape search() noexcept
+    {
+        shape out;
+        for (auto const& s : spellings)
+        {
+            if (s.empty()) continue;
+            ++out.count;
+            out.min_length = std::min(out.min_length, s.size());
+            out.max_length = std::max(out.max_length, s.size());
+        }
+        while (out.size < out.count * 2)
+        {
+            out.size *= 2;
+        }
+        constexpr std::size_t max_size = std::size_t{1} << 16;
+        std::array<std::uint64_t, max_size / 64> used{};
+        std::array<std::size_t, Traits::token_count> taken{};
+        for (; out.size <= max_size; out.size *= 2)
+        {
+            for (out.seed = 1; out.seed <= 64; ++out.seed)
+            {
+                std::size_t n = 0;
+                bool unique = true;
+                for (std::size_t i = 0; i < spellings.size() && unique; ++i)
+                {
+                    if (spellings[i].empty()) continue;
+                    auto const slot = keyword_hash(spellings[i], out.seed) & (out.size - 1);
+                    unique = !((used[slot / 64] >> (slot % 64)) & 1);
+                    used[slot / 64] |= std::uint64_t{1} << (slot % 64);
+                    taken[n++] = slot;
+                }
+                // Only clear the slots which were set
+                for (std::size_t i = 0; i < n; ++i) used[taken[i] / 64] = 0;
+                if (unique) return out;
+            }
+        }
+        keyword_hash_not_found();
+        return out;
+    }
+
+    static constexpr shape params = search();
+
+    using index_t = std::conditional_t<(Traits::token_count < 0x100), std::uint8_t, std::uint16_t>;
+
+    struct table
+    {
+        // Token index of the keyword hashed to each slot, or none
+        std::array<index_t, params.size> slots{};
+    };
+
+    static constexpr table impl() noexcept
+    {
+        table out{};
+        for (auto& slot : out.slots) slot = static_cast<index_t>(none);
+        for (std::size_t i = 0; i < spellings.size(); ++i)
+        {
+            if (spellings[i].empty()) continue;
+            out.slots[keyword_hash(spellings[i], params.seed) & (params.size - 1)] = static_cast<index_t>(i);
+        }
+        return out;
+    }
+
+    static constexpr table slots = impl();
+
+    // Token index of the keyword spelled by s, or fallback if it is not a keyword
+    static constexpr std::size_t find(std::string_view s, std::size_t fallback) noexcept
+    {
+        if (s.size() < params.min_length || s.size() > params.max_length) return fallback;
+        std::size_t const index = slots.slots[keyword_hash(s, params.seed) & (params.size - 1)];
+        return index != none && spellings[index] == s ? index : fallback;
+    }
+};
+
+// Perfect hash over the keyword spellings of a grammar
+template <typename Traits>
+using keywords = make_keywords<Traits>;
 } // namespace detail
 
+struct regex_engine
+{
+    template <typename Traits>
+    static constexpr Match match(std::string_view src) noexcept
+    {
+        // Default to no match
+        Match result{Traits::token_count, 0};
+        if (src.empty()) return result;
+        // Only the patterns which can begin with the next byte are candidates
+        auto const byte = static_cast<unsigned char>(src.front());
+        auto const& table = detail::dispatch_table<Traits>;
+        if (table.direct[byte] < Traits::token_count) return Match{table.direct[byte], 1};
+        // Evaluate the candidates in enum order, the index of the winning pattern is known directly
+        // rather than searching a tuple of capture groups for it
+        for (std::size_t w = 0; w < table.candidates[byte].size(); ++w)
+        {
+            for (auto bits = table.candidates[byte][w]; bits; bits &= bits - 1)
+            {
+                auto const i = w * 64 + static_cast<std::size_t>(__builtin_ctzll(bits));
+                auto const match = detail::dispatch<Traits>::matchers[i](src);
+                if (match.index == Traits::token_count)
+                {
+                    if constexpr (Traits::stats_t::enabled)
+                    {
+                        if (!REGLEX_IS_CONSTANT_EVALUATED()) Traits::stats_t::template failed<Traits>(i);
+                    }
+                    continue;
+                }
+                // In leftmost-first mode the first match wins, otherwise only a strictly longer
+                // match replaces an earlier one
+                if (!Traits::longest_match) return match;
+                if (match.length > result.length) result = match;
+            }
+        }
+        return result;
+    }
+};
+
 enum class Status
 {
     NoMatch = 0,
@@ -124,81 +502,471 @@ struct LexResult
     Status status = Status::NoMatch;
 };
 
+namespace detail
+{
+// The next token, after any trivia
+struct Scanned
+{
+    Skipped skipped;
+    std::size_t index;
+    std::size_t length;
+};
+
+// Matches the token src begins with, the skipped trivia having already been removed from it.
+// Resolves keywords but leaves line accounting to the caller.
+template <typename Traits>
+constexpr Scanned scan_skipped(std::string_view src, Skipped const& skipped) noexcept
+{
+    using tables = detail::tables<Traits>;
+    using stats = typename Traits::stats_t;
+    [[maybe_unused]] std::uint64_t started = 0;
+    if constexpr (stats::enabled)
+    {
+        if (!REGLEX_IS_CONSTANT_EVALUATED()) started = stats::now();
+    }
+    // Attempt to match our grammar at the current position
+    auto const match = Traits::engine_t::template match<Traits>(src);
+    // Identifier like tokens become keywords when they spell one
+    auto index = match.index;
+    if constexpr (keywords<Traits>::params.count != 0)
+    {
+        if (index < Traits::token_count && tables::has_keywords[index])
+        {
+            index = keywords<Traits>::find(src.substr(0, match.length), index);
+        }
+    }
+    if constexpr (stats::enabled)
+    {
+        // Running out of input isn't a failure to match
+        if (!REGLEX_IS_CONSTANT_EVALUATED() && (index < Traits::token_count || !src.empty()))
+        {
+            stats::template matched<Traits>(index, match.length, started);
+        }
+    }
+    if (index >= Traits::token_count) return {skipped, index, 0};
+    return {skipped, index, match.length};
+}
+
+// Skips trivia and matches the next token
+template <typename Traits>
+constexpr Scanned scan(std::string_view src) noexcept
+{
+    // Consume any leading trivia, so that the match can be anchored
+    auto const skipped = Traits::skip_t::skip(src);
+    return scan_skipped<Traits>(src.substr(skipped.length), skipped);
+}
+} // namespace detail
+
+// Single tokens are always returned in the full layout, as there is no buffer to resolve a compact
+// token against
 template <typename Traits>
 constexpr auto lex_token(std::string_view src, std::size_t line = 0)
 {
-    using token_t = typename Traits::token_t;
-    using matcher_t = typename Traits::matcher_t;
+    using token_t = Token<typename Traits::token_type_t>;
+    using tables = detail::tables<Traits>;
     // Default to an EOF
     LexResult<token_t> result;
-    // Attempt to match our grammar, produces a tuple of match results
-    auto const matches = ctre::search<detail::pattern<Traits>>(src);
-    // Function to check for matches in the result tuple
-    auto const extract_match = [&](auto i) {
-        auto const& group = matches.template get<i.value>();
-        // Index zero is a full match, which we are not interested in
-        if (i.value == 0 || !group) return;
-        // Build a new token from this match groups token type
-        // Guard with the multiply to ensure that we don't use a negative index
-        constexpr auto type = Traits::template lookup<(i.value - 1) * !!i.value>;
-        constexpr Status status = matcher_t::template filter_out<type> ? Status::FilteredMatch : Status::UnfilteredMatch;
-        // Get a view to the substring which matched this tokens pattern
-        auto const lexeme = group.view();
-        // Calculate the line that the lexeme began on
-        auto const first_line =
-            line + static_cast<std::size_t>(std::count(src.begin(), lexeme.begin(), '\n'));
-        // Calculate how many lines this lexeme spans
-        auto const num_lines = static_cast<std::size_t>(std::count(lexeme.begin(), lexeme.end(), '\n'));
-        // Set the result token
-        result.token = token_t{type, lexeme, first_line, num_lines};
-        result.status = status;
-    };
-    // Apply our matcher to each match group, with its group index
-    detail::for_n<Traits::token_count>(extract_match);
+    auto const scanned = detail::scan<Traits>(src);
+    if (scanned.index >= Traits::token_count) return result;
+    // Get a view to the substring which matched this tokens pattern
+    auto const lexeme = src.substr(scanned.skipped.length, scanned.length);
+    // The lexeme begins directly after the skipped trivia
+    auto const first_line = line + scanned.skipped.lines;
+    // Calculate how many lines this lexeme spans, std::count isn't constexpr until C++20
+    std::size_t num_lines = 0;
+    for (auto const c : lexeme)
+    {
+        num_lines += c == '\n';
+    }
+    // Build a new token from the matched alternatives token type
+    result.token = token_t{tables::types[scanned.index], lexeme, first_line, num_lines};
+    result.status = tables::filtered[scanned.index] ? Status::FilteredMatch : Status::UnfilteredMatch;
     return result;
 }
 
+namespace detail
+{
+template <typename T>
+struct is_compact_token : std::false_type
+{
+};
+
+template <typename TokenType>
+struct is_compact_token<CompactToken<TokenType>> : std::true_type
+{
+};
+
+// Offset of a token's lexeme within the source it was lexed from
+template <typename T>
+std::size_t token_offset(T const& tok, std::string_view source) noexcept
+{
+    if constexpr (is_compact_token<T>::value)
+        return tok.offset;
+    else
+        return static_cast<std::size_t>(tok.lexeme.data() - source.data());
+}
+
+// Where lexing stopped, failed is set when no pattern matched at offset. line is the line offset
+// is on, only counted when the sink asks for it, compact tokens are resolved through an index.
+struct LexStop
+{
+    std::size_t offset;
+    bool failed;
+    std::size_t line = 0;
+};
+
+// Whether a token lies within reach of 32 bit offsets, as used by compact tokens and lex_soa
+constexpr bool fits_32(std::size_t start, std::size_t length) noexcept
+{
+    return start + length <= std::numeric_limits<std::uint32_t>::max();
+}
+
+// Builds a token of either layout, compact offsets being relative to the lexed source
 template <typename T>
+T make_token(typename T::token_type_t type,
+             std::size_t start,
+             std::string_view lexeme,
+             std::size_t first_line,
+             std::size_t num_lines) noexcept
+{
+    if constexpr (is_compact_token<T>::value)
+        return T{static_cast<std::uint32_t>(start), static_cast<std::uint32_t>(lexeme.size()), type};
+    else
+        return T{type, lexeme, first_line, num_lines};
+}
+
+// Hooks of a drive sink which do nothing, each sink hides those it needs
+struct sink_base
+{
+    // Whether lines are counted through each lexeme for the tokens emitted
+    static constexpr bool counts_lines = true;
+
+    // Called once trivia is skipped, before matching at start. Returning false stops at start.
+    bool ready(std::size_t) noexcept { return true; }
+    // Called with every match, returning false stops before it as a failure
+    bool fits(std::size_t, std::size_t) noexcept { return true; }
+};
+
+// The lexing loop shared by lex, lexing into a buffer, token_range, StreamLexer and lex_soa. Lexes
+// the tokens which begin in [offset, last), line being the line offset is on, passing those not
+// filtered to sink.emit(type, start, lexeme, first_line, num_lines), which returns false to stop
+// after the token. Trivia running to the end of the source is left unconsumed, as is what no
+// pattern matches. Trivia running past last is consumed as far as last. Tokens may run past last,
+// the returned offset is then the end of the final one.
+template <typename Traits, typename Sink>
+LexStop drive(std::string_view source, std::size_t offset, std::size_t last, std::size_t line, Sink& sink)
+{
+    using tables = detail::tables<Traits>;
+    // Consume until we're out of input characters
+    while (offset < last)
+    {
+        auto const rest = source.substr(offset);
+        auto const skipped = Traits::skip_t::skip(rest);
+        if (skipped.length == rest.size()) break;
+        auto const start = offset + skipped.length;
+        if (start >= last)
+        {
+            // The next token is left to whoever lexes from last, as a chunk after this one does
+            if constexpr (Sink::counts_lines)
+            {
+                line += static_cast<std::size_t>(std::count(rest.begin(), rest.begin() + (last - offset), '\n'));
+            }
+            return {last, false, line};
+        }
+        if (!sink.ready(start)) return {start, false, line + skipped.lines};
+        // Try to lex the next token
+        auto const scanned = scan_skipped<Traits>(rest.substr(skipped.length), skipped);
+        if (scanned.index >= Traits::token_count || !sink.fits(start, scanned.length)) return {offset, true, line};
+        // Advance past the source for this lexeme
+        auto const lexeme = source.substr(start, scanned.length);
+        auto const first_line = line + skipped.lines;
+        std::size_t num_lines = 0;
+        if constexpr (Sink::counts_lines)
+        {
+            num_lines = static_cast<std::size_t>(std::count(lexeme.begin(), lexeme.end(), '\n'));
+        }
+        offset = start + scanned.length;
+        line = first_line + num_lines;
+        if (tables::filtered[scanned.index]) continue;
+        if (!sink.emit(tables::types[scanned.index], start, lexeme, first_line, num_lines)) break;
+    }
+    return {offset, false, line};
+}
+
+// Sink appending tokens of either layout to a vector. Full tokens carry their lines, compact ones
+// take them from an index and can't address past 4GiB, leaving the rest as the remainder.
+template <typename Tokens>
+struct vector_sink : sink_base
+{
+    using T = typename Tokens::value_type;
+
+    static constexpr bool counts_lines = !is_compact_token<T>::value;
+
+    explicit vector_sink(Tokens& tokens) noexcept : out(tokens) {}
+
+    bool fits(std::size_t start, std::size_t length) const noexcept
+    {
+        return !is_compact_token<T>::value || fits_32(start, length);
+    }
+
+    bool emit(typename T::token_type_t type,
+              std::size_t start,
+              std::string_view lexeme,
+              std::size_t first_line,
+              std::size_t num_lines)
+    {
+        out.push_back(make_token<T>(type, start, lexeme, first_line, num_lines));
+        return true;
+    }
+
+    Tokens& out;
+};
+
+// Lexes every token which begins in [offset, last) onto the out vector, line being the line offset
+// is on
+template <typename Traits, typename Tokens>
+LexStop lex_until(std::string_view source, std::size_t offset, std::size_t last, std::size_t line, Tokens& out)
+{
+    vector_sink<Tokens> sink(out);
+    return drive<Traits>(source, offset, last, line, sink);
+}
+} // namespace detail
+
+/// Tokens lexed from a source. Token and index storage comes from Allocator, so that a result can
+/// live in an arena, see pmr::Lexed.
+template <typename T, typename Allocator = std::allocator<T>>
 struct Lexed
 {
-    std::vector<T> tokens;
+    using allocator_type = Allocator;
+    using line_index_t = BasicLineIndex<typename std::allocator_traits<Allocator>::template rebind_alloc<std::uint64_t>>;
+
+    std::vector<T, Allocator> tokens;
     std::string_view remainder;
+    // The lexed source, and for compact tokens its newline index which they are resolved against.
+    // Full tokens hold their own lines, so the index is left empty for them.
+    std::string_view source;
+    line_index_t lines;
+
+    Lexed() = default;
+    explicit Lexed(Allocator const& alloc) : tokens(alloc), lines(typename line_index_t::allocator_type(alloc)) {}
+
+    // Accessors which work for either token layout
+    std::size_t offset(T const& tok) const noexcept { return detail::token_offset(tok, source); }
+
+    std::string_view lexeme(T const& tok) const noexcept
+    {
+        if constexpr (detail::is_compact_token<T>::value)
+            return source.substr(tok.offset, tok.length);
+        else
+            return tok.lexeme;
+    }
+
+    std::size_t first_line(T const& tok) const noexcept
+    {
+        if constexpr (detail::is_compact_token<T>::value)
+            return lines.line_of(tok.offset);
+        else
+            return tok.first_line;
+    }
+
+    std::size_t num_lines(T const& tok) const noexcept
+    {
+        if constexpr (detail::is_compact_token<T>::value)
+            return lines.lines_between(tok.offset, std::size_t{tok.offset} + tok.length);
+        else
+            return tok.num_lines;
+    }
+
+    /// Full token for either layout
+    Token<typename T::token_type_t> view(T const& tok) const noexcept
+    {
+        return {tok.type, lexeme(tok), first_line(tok), num_lines(tok)};
+    }
 };
 
-template <typename Traits>
-Lexed<typename Traits::token_t> lex(std::string_view source)
+template <typename Traits, typename Allocator = std::allocator<typename Traits::token_t>>
+Lexed<typename Traits::token_t, Allocator> lex(std::string_view source, Allocator const& alloc = Allocator())
 {
     // Build this token list
-    Lexed<typename Traits::token_t> res;
-    // Keep track of the line we're processing
+    using lexed_t = Lexed<typename Traits::token_t, Allocator>;
+    lexed_t res(alloc);
+    res.source = source;
+    // Compact token lines come from one pass over the whole source, full tokens count their own
+    if constexpr (detail::is_compact_token<typename Traits::token_t>::value)
+    {
+        res.lines = typename lexed_t::line_index_t(source, typename lexed_t::line_index_t::allocator_type(alloc));
+    }
+    auto const stop = detail::lex_until<Traits>(source, 0, source.size(), 0, res.tokens);
+    res.remainder = source.substr(stop.offset);
+    return res;
+}
+
+namespace pmr
+{
+template <typename T>
+using Lexed = REGLEX_NAMESPACE::Lexed<T, std::pmr::polymorphic_allocator<T>>;
+
+/// Lexes with every allocation taken from resource, such as a per request monotonic arena
+template <typename Traits>
+Lexed<typename Traits::token_t> lex(std::string_view source, std::pmr::memory_resource* resource)
+{
+    return REGLEX_NAMESPACE::lex<Traits>(source, std::pmr::polymorphic_allocator<typename Traits::token_t>(resource));
+}
+} // namespace pmr
+
+/// Where lexing into caller provided storage stopped
+struct LexWritten
+{
+    // Tokens written
+    std::size_t count = 0;
+    // First unconsumed character and the line it is on, lexing resumes from source.substr(offset)
+    std::size_t offset = 0;
     std::size_t line = 0;
-    [&]{
-        // Consume until we're out of input characters
-        while (!source.empty())
+};
+
+namespace detail
+{
+// Sink writing through an output iterator until max tokens are written
+template <typename T, typename OutputIt>
+struct output_sink : sink_base
+{
+    output_sink(OutputIt it, std::size_t max_tokens) : out(it), max(max_tokens) {}
+
+    bool fits(std::size_t start, std::size_t length) const noexcept
+    {
+        return !is_compact_token<T>::value || fits_32(start, length);
+    }
+
+    bool emit(typename T::token_type_t type,
+              std::size_t start,
+              std::string_view lexeme,
+              std::size_t first_line,
+              std::size_t num_lines)
+    {
+        *out = make_token<T>(type, start, lexeme, first_line, num_lines);
+        ++out;
+        return ++count < max;
+    }
+
+    OutputIt out;
+    std::size_t max;
+    std::size_t count = 0;
+};
+} // namespace detail
+
+/// Lexes into caller provided storage, writing at most max_tokens tokens through out. Nothing is
+/// allocated, lines are counted as tokens are lexed rather than through an index. Stops when the
+/// output is full, the source is consumed, or no pattern matches. Compact token offsets are
+/// relative to the source passed in, line is the line that source begins on.
+template <typename Traits, typename OutputIt>
+LexWritten lex(std::string_view source, OutputIt out, std::size_t max_tokens, std::size_t line = 0)
+{
+    if (max_tokens == 0) return {0, 0, line};
+    detail::output_sink<typename Traits::token_t, OutputIt> sink(out, max_tokens);
+    auto const stop = detail::drive<Traits>(source, 0, source.size(), line, sink);
+    return {sink.count, stop.offset, stop.line};
+}
+
+/// Lexes into the buffer [first, last), see above
+template <typename Traits>
+LexWritten lex(std::string_view source, typename Traits::token_t* first, typename Traits::token_t* last, std::size_t line = 0)
+{
+    return lex<Traits>(source, first, static_cast<std::size_t>(last - first), line);
+}
+
+/// Lazily lexed view of a source. Tokens are produced one at a time as the range is iterated, so
+/// nothing is allocated and the source is only touched once. Iteration ends at the end of the
+/// source, or at the first position which no pattern matches. Tokens are always yielded in the full
+/// layout, as nothing is stored.
+template <typename Traits>
+struct token_range
+{
+    using token_t = Token<typename Traits::token_type_t>;
+
+    class iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = token_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = token_t const*;
+        using reference = token_t const&;
+
+        iterator() = default;
+        iterator(std::string_view source, std::size_t line) : source_(source), line_(line), done_(false)
         {
-            // Try to lex the next token
-            auto lexed = lex_token<Traits>(source, line);
-            switch (lexed.status)
-            {
-            case Status::NoMatch: return;
-            case Status::FilteredMatch:
-            case Status::UnfilteredMatch:
+            advance();
+        }
+
+        reference operator*() const noexcept { return token_; }
+        pointer operator->() const noexcept { return &token_; }
+
+        iterator& operator++()
+        {
+            advance();
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            auto tmp = *this;
+            advance();
+            return tmp;
+        }
+
+        friend bool operator==(iterator const& lhs, iterator const& rhs) noexcept
+        {
+            return lhs.done_ == rhs.done_ && (lhs.done_ || lhs.offset_ == rhs.offset_);
+        }
+        friend bool operator!=(iterator const& lhs, iterator const& rhs) noexcept { return !(lhs == rhs); }
+
+        /// Source which has not been consumed yet, once iteration has ended this is the unlexed input
+        std::string_view remainder() const noexcept { return source_.substr(offset_); }
+
+    private:
+        // Sink keeping the first token, then stopping
+        struct next_sink : detail::sink_base
+        {
+            bool emit(typename token_t::token_type_t type,
+                      std::size_t,
+                      std::string_view lexeme,
+                      std::size_t first_line,
+                      std::size_t num_lines) noexcept
             {
-                // Advance past the source for this lexeme
-                source = source.substr(static_cast<std::size_t>(&lexed.token.lexeme.back() + 1 - source.data()));
-                // Update the line number
-                line = lexed.token.first_line + lexed.token.num_lines;
-                // Add the token to our stream
-                if (lexed.status == Status::UnfilteredMatch)
-                    res.tokens.emplace_back(std::move(lexed.token));
-                break;
-            }
+                token = token_t{type, lexeme, first_line, num_lines};
+                found = true;
+                return false;
             }
+
+            token_t token{};
+            bool found = false;
+        };
+
+        void advance()
+        {
+            next_sink sink;
+            auto const stop = detail::drive<Traits>(source_, offset_, source_.size(), line_, sink);
+            offset_ = stop.offset;
+            line_ = stop.line;
+            token_ = sink.token;
+            done_ = !sink.found;
         }
-    }();
-    res.remainder = source;
-    return res;
-}
+
+        std::string_view source_;
+        std::size_t offset_ = 0;
+        std::size_t line_ = 0;
+        token_t token_{};
+        bool done_ = true;
+    };
+
+    std::string_view source;
+    std::size_t first_line = 0;
+
+    explicit token_range(std::string_view src, std::size_t line = 0) : source(src), first_line(line) {}
+
+    iterator begin() const { return iterator(source, first_line); }
+    iterator end() const { return iterator(); }
+};
 
 /// Useful regex constants
 static constexpr std::string_view identifier = R"([a-zA-Z_]\w*)";
@@ -207,6 +975,7 @@ static constexpr std::string_view string = R"("[^"]*")";
 static constexpr std::string_view real_number = R"([0-9]+(?:\.[0-9]+)?)";
 static constexpr std::string_view integer = R"([1-9][0-9]*)";
 static constexpr std::string_view non_whitespace = R"([^\s]+)";
+static constexpr std::string_view non_whitespace_char = R"([^\s])";
 } // namespace REGLEX_NAMESPACE
 
 #if defined(REGLEX_USE_MACROS)
@@ -0,0 +1,357 @@
+#pragma once
+#if !defined(REGLEX_SERIALIZE_H)
+#define REGLEX_SERIALIZE_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <reglex/mmap.hpp>
+#include <reglex/reglex.hpp>
+
+namespace REGLEX_NAMESPACE
+{
+namespace detail
+{
+constexpr std::uint64_t fnv1a(std::string_view s, std::uint64_t h = 14695981039346656037u) noexcept
+{
+    for (auto c : s)
+    {
+        h = (h ^ static_cast<unsigned char>(c)) * 1099511628211u;
+    }
+    return h;
+}
+
+constexpr std::uint64_t fnv1a(std::uint64_t value, std::uint64_t h) noexcept
+{
+    for (std::size_t i = 0; i < 8; ++i)
+    {
+        h = (h ^ (value >> (8 * i) & 0xFF)) * 1099511628211u;
+    }
+    return h;
+}
+
+// Spelling of a type, good enough to tell policies apart in a fingerprint
+template <typename T>
+constexpr std::string_view type_signature() noexcept
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    return __FUNCSIG__;
+#else
+    return __PRETTY_FUNCTION__;
+#endif
+}
+
+template <typename Traits, std::size_t... I>
+constexpr std::uint64_t make_fingerprint(std::index_sequence<I...>) noexcept
+{
+    using matcher_t = typename Traits::matcher_t;
+    using underlying_t = std::underlying_type_t<typename Traits::token_type_t>;
+    auto h = fnv1a(Traits::token_count, fnv1a(""));
+    // Everything which decides what a token is, in enum order
+    ((h = fnv1a(matcher_t::template pattern<Traits::template lookup<I>>, h),
+      h = fnv1a(matcher_t::template keyword<Traits::template lookup<I>>, h),
+      h = fnv1a(static_cast<std::uint64_t>(static_cast<underlying_t>(Traits::template lookup<I>)), h),
+      h = fnv1a(std::uint64_t{matcher_t::template filter_out<Traits::template lookup<I>>} |
+                    std::uint64_t{matcher_t::template has_keywords<Traits::template lookup<I>>} << 1,
+                h)),
+     ...);
+    h = fnv1a(type_signature<typename Traits::skip_t>(), h);
+    h = fnv1a(type_signature<typename Traits::engine_t>(), h);
+    return fnv1a(std::uint64_t{Traits::longest_match}, h);
+}
+
+// Little endian stores and loads, so files move between hosts
+template <typename U>
+void store_le(std::vector<char>& out, U value)
+{
+    for (std::size_t i = 0; i < sizeof(U); ++i)
+    {
+        out.push_back(static_cast<char>(static_cast<std::uint64_t>(value) >> (8 * i) & 0xFF));
+    }
+}
+
+template <typename U>
+U load_le(char const* p) noexcept
+{
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < sizeof(U); ++i)
+    {
+        value |= std::uint64_t{static_cast<unsigned char>(p[i])} << (8 * i);
+    }
+    return static_cast<U>(value);
+}
+
+// Writes a whole buffer to a new file beside path, then renames it into place so readers never
+// see a partial file
+inline bool write_file(std::string const& path, std::vector<char> const& data)
+{
+    // Unique per process and call, as threads may store the same path at once
+    static std::atomic<std::uint64_t> counter{0};
+    auto const temp = path + ".tmp." + std::to_string(::getpid()) + "." + std::to_string(counter.fetch_add(1));
+    auto const fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    std::size_t done = 0;
+    while (done < data.size())
+    {
+        auto const n = ::write(fd, data.data() + done, data.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += static_cast<std::size_t>(n);
+    }
+    bool const ok = ::close(fd) == 0 && done == data.size() && std::rename(temp.c_str(), path.c_str()) == 0;
+    if (!ok) std::remove(temp.c_str());
+    return ok;
+}
+} // namespace detail
+
+/// Hash of everything in a grammar which decides its tokens: patterns, keywords, enum values,
+/// filters, and the skip, engine and longest match policies. Files written for one grammar are
+/// refused by any other.
+template <typename Traits>
+static constexpr std::uint64_t grammar_fingerprint =
+    detail::make_fingerprint<Traits>(std::make_index_sequence<Traits::token_count>{});
+
+/// Serialized token stream layout. All fields are little endian and every section starts on an 8
+/// byte boundary, so a mapped file can be read in place.
+///
+///     header     64 bytes, see below
+///     tokens     token_count records of u32 offset, u32 length and u32 enum value, padded to 8
+///     bits       line_words u64 newline bit words, as BasicLineIndex::bits
+///     blocks     line_blocks u64 newline counts, as BasicLineIndex::blocks
+///
+/// The header holds the magic "REGLEXTK", u32 version and header size, then u64 grammar
+/// fingerprint, source size, token count, remainder offset, line words and line blocks.
+struct token_file_format
+{
+    static constexpr char magic[8] = {'R', 'E', 'G', 'L', 'E', 'X', 'T', 'K'};
+    static constexpr std::uint32_t version = 1;
+    static constexpr std::size_t header_size = 64;
+    static constexpr std::size_t record_size = 12;
+
+    static constexpr std::size_t tokens_size(std::size_t count) noexcept { return (count * record_size + 7) / 8 * 8; }
+};
+
+/// Serializes a lexed source of either layout. The source itself isn't stored, a reader must be
+/// given the same text. Fails for sources over 4GiB, which compact offsets can't address, and when
+/// the file can't be written.
+template <typename Traits, typename T, typename Allocator>
+bool save_tokens(Lexed<T, Allocator> const& lexed, std::string const& path)
+{
+    using underlying_t = std::underlying_type_t<typename T::token_type_t>;
+    using format = token_file_format;
+    if (lexed.source.size() > std::numeric_limits<std::uint32_t>::max()) return false;
+    // A default constructed index is empty, build one when the lexer didn't
+    typename Lexed<T, Allocator>::line_index_t built;
+    auto const* lines = &lexed.lines;
+    if (lines->bits.size() != lexed.source.size() / 64 + 1)
+    {
+        built = typename Lexed<T, Allocator>::line_index_t(lexed.source);
+        lines = &built;
+    }
+
+    std::vector<char> out;
+    out.reserve(format::header_size + format::tokens_size(lexed.tokens.size()) +
+                8 * (lines->bits.size() + lines->blocks.size()));
+    out.insert(out.end(), std::begin(format::magic), std::end(format::magic));
+    detail::store_le(out, format::version);
+    detail::store_le(out, static_cast<std::uint32_t>(format::header_size));
+    detail::store_le(out, grammar_fingerprint<Traits>);
+    detail::store_le(out, std::uint64_t{lexed.source.size()});
+    detail::store_le(out, std::uint64_t{lexed.tokens.size()});
+    detail::store_le(out, std::uint64_t{lexed.source.size() - lexed.remainder.size()});
+    detail::store_le(out, std::uint64_t{lines->bits.size()});
+    detail::store_le(out, std::uint64_t{lines->blocks.size()});
+    for (auto const& tok : lexed.tokens)
+    {
+        detail::store_le(out, static_cast<std::uint32_t>(lexed.offset(tok)));
+        detail::store_le(out, static_cast<std::uint32_t>(lexed.lexeme(tok).size()));
+        detail::store_le(out, static_cast<std::uint32_t>(static_cast<underlying_t>(tok.type)));
+    }
+    out.resize(format::header_size + format::tokens_size(lexed.tokens.size()));
+    for (auto word : lines->bits)
+    {
+        detail::store_le(out, word);
+    }
+    for (auto count : lines->blocks)
+    {
+        detail::store_le(out, std::uint64_t{count});
+    }
+    return detail::write_file(path, out);
+}
+
+/// Mapped view of a file written by save_tokens, read in place. Opening checks the header, the
+/// grammar fingerprint and that the sections fit the file, after which tokens and lines are read
+/// straight from the mapping.
+template <typename Traits>
+class TokenFile
+{
+public:
+    using token_type_t = typename Traits::token_type_t;
+    using token_t = CompactToken<token_type_t>;
+    using format = token_file_format;
+
+    /// Iterates the stored tokens, decoding each record as it is read
+    class iterator
+    {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = token_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = token_t;
+
+        iterator() = default;
+        explicit iterator(char const* at) : at_(at) {}
+
+        token_t operator*() const noexcept { return decode(at_); }
+        token_t operator[](difference_type n) const noexcept { return decode(at_ + n * record); }
+
+        iterator& operator++() noexcept { return *this += 1; }
+        iterator operator++(int) noexcept { auto tmp = *this; ++*this; return tmp; }
+        iterator& operator--() noexcept { return *this -= 1; }
+        iterator operator--(int) noexcept { auto tmp = *this; --*this; return tmp; }
+        iterator& operator+=(difference_type n) noexcept { at_ += n * record; return *this; }
+        iterator& operator-=(difference_type n) noexcept { at_ -= n * record; return *this; }
+        friend iterator operator+(iterator it, difference_type n) noexcept { return it += n; }
+        friend iterator operator+(difference_type n, iterator it) noexcept { return it += n; }
+        friend iterator operator-(iterator it, difference_type n) noexcept { return it -= n; }
+        friend difference_type operator-(iterator a, iterator b) noexcept { return (a.at_ - b.at_) / record; }
+        friend bool operator==(iterator a, iterator b) noexcept { return a.at_ == b.at_; }
+        friend bool operator!=(iterator a, iterator b) noexcept { return a.at_ != b.at_; }
+        friend bool operator<(iterator a, iterator b) noexcept { return a.at_ < b.at_; }
+        friend bool operator>(iterator a, iterator b) noexcept { return a.at_ > b.at_; }
+        friend bool operator<=(iterator a, iterator b) noexcept { return a.at_ <= b.at_; }
+        friend bool operator>=(iterator a, iterator b) noexcept { return a.at_ >= b.at_; }
+
+    private:
+        static constexpr difference_type record = static_cast<difference_type>(format::record_size);
+
+        char const* at_ = nullptr;
+    };
+
+    TokenFile() = default;
+
+    explicit TokenFile(std::string const& path) : file_(path) { valid_ = file_.is_open() && check(); }
+
+    /// True when the file was read and matches this grammar
+    bool is_valid() const noexcept { return valid_; }
+    explicit operator bool() const noexcept { return valid_; }
+
+    std::size_t source_size() const noexcept { return source_size_; }
+    std::size_t size() const noexcept { return count_; }
+    iterator begin() const noexcept { return iterator(tokens_); }
+    iterator end() const noexcept { return iterator(tokens_ + count_ * format::record_size); }
+    token_t operator[](std::size_t i) const noexcept { return decode(tokens_ + i * format::record_size); }
+
+    /// Zero based line of a source offset, read from the stored newline index
+    std::size_t line_of(std::size_t offset) const noexcept
+    {
+        return detail::newlines_before<LineIndex::words_per_block>(bits_, blocks_, offset);
+    }
+
+    /// Copies the tokens out against source, which must be the text they were lexed from. Gives an
+    /// empty result with the whole source as the remainder when source is the wrong size.
+    template <typename T = typename Traits::token_t>
+    Lexed<T> load(std::string_view source) const
+    {
+        Lexed<T> res;
+        res.source = source;
+        res.remainder = source;
+        if (!valid_ || source.size() != source_size_) return res;
+        if constexpr (detail::is_compact_token<T>::value)
+        {
+            res.lines.bits.assign(bits_, bits_ + words_);
+            res.lines.blocks.assign(blocks_, blocks_ + block_count_);
+        }
+        res.tokens.reserve(count_);
+        for (auto const tok : *this)
+        {
+            // A token past the end means the file doesn't belong to this source
+            if (std::size_t{tok.offset} + tok.length > source.size())
+            {
+                res.tokens.clear();
+                res.remainder = source;
+                return res;
+            }
+            if constexpr (detail::is_compact_token<T>::value)
+            {
+                res.tokens.push_back(tok);
+            }
+            else
+            {
+                auto const lexeme = source.substr(tok.offset, tok.length);
+                auto const first = line_of(tok.offset);
+                res.tokens.push_back(T{tok.type, lexeme, first, line_of(std::size_t{tok.offset} + tok.length) - first});
+            }
+        }
+        res.remainder = source.substr(remainder_);
+        return res;
+    }
+
+private:
+    static token_t decode(char const* p) noexcept
+    {
+        using underlying_t = std::underlying_type_t<token_type_t>;
+        return {detail::load_le<std::uint32_t>(p),
+                detail::load_le<std::uint32_t>(p + 4),
+                static_cast<token_type_t>(static_cast<underlying_t>(detail::load_le<std::uint32_t>(p + 8)))};
+    }
+
+    bool check() noexcept
+    {
+        // The line index is read in place, which needs the file's byte order
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        return false;
+#endif
+        auto const data = file_.view();
+        if (data.size() < format::header_size) return false;
+        auto const* p = data.data();
+        if (std::memcmp(p, format::magic, sizeof(format::magic)) != 0) return false;
+        if (detail::load_le<std::uint32_t>(p + 8) != format::version) return false;
+        if (detail::load_le<std::uint32_t>(p + 12) != format::header_size) return false;
+        if (detail::load_le<std::uint64_t>(p + 16) != grammar_fingerprint<Traits>) return false;
+        source_size_ = detail::load_le<std::uint64_t>(p + 24);
+        count_ = detail::load_le<std::uint64_t>(p + 32);
+        remainder_ = detail::load_le<std::uint64_t>(p + 40);
+        words_ = detail::load_le<std::uint64_t>(p + 48);
+        block_count_ = detail::load_le<std::uint64_t>(p + 56);
+        // Sizes are bounded first so the section arithmetic below can't overflow
+        if (source_size_ > std::numeric_limits<std::uint32_t>::max() || remainder_ > source_size_) return false;
+        if (count_ > data.size() || words_ != source_size_ / 64 + 1 ||
+            block_count_ != words_ / LineIndex::words_per_block + 1)
+            return false;
+        auto const tokens_end = format::header_size + format::tokens_size(count_);
+        if (data.size() != tokens_end + 8 * (words_ + block_count_)) return false;
+        tokens_ = p + format::header_size;
+        bits_ = reinterpret_cast<std::uint64_t const*>(p + tokens_end);
+        blocks_ = bits_ + words_;
+        return true;
+    }
+
+    MappedFile file_;
+    bool valid_ = false;
+    std::size_t source_size_ = 0;
+    std::size_t count_ = 0;
+    std::size_t remainder_ = 0;
+    std::size_t words_ = 0;
+    std::size_t block_count_ = 0;
+    char const* tokens_ = nullptr;
+    std::uint64_t const* bits_ = nullptr;
+    std::uint64_t const* blocks_ = nullptr;
+};
+} // namespace REGLEX_NAMESPACE
+
+#endif // REGLEX_SERIALIZE_H
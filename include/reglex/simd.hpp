@@ -0,0 +1,171 @@
+#pragma once
+#if !defined(REGLEX_SIMD_H)
+#define REGLEX_SIMD_H
+
+#if !defined(REGLEX_NAMESPACE)
+#define REGLEX_NAMESPACE reglex
+#endif
+
+#include <cstddef>
+#include <cstdint>
+
+// Vector width is picked at compile time from the target flags, define REGLEX_NO_SIMD to force the
+// scalar paths
+#if !defined(REGLEX_NO_SIMD)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define REGLEX_SIMD_WIDTH 32
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define REGLEX_SIMD_WIDTH 16
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define REGLEX_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#else
+#define REGLEX_IS_CONSTANT_EVALUATED() false
+#endif
+
+namespace REGLEX_NAMESPACE
+{
+namespace detail
+{
+namespace simd
+{
+// Bit masks over one block of input, bit i describes byte i
+struct block_masks
+{
+    std::uint64_t whitespace;
+    std::uint64_t newline;
+};
+
+#if defined(REGLEX_SIMD_WIDTH)
+static constexpr std::size_t width = REGLEX_SIMD_WIDTH;
+static constexpr std::uint64_t full_block = (std::uint64_t{1} << width) - 1;
+
+// Classifies one unaligned block, whitespace is ' ' and '\t' through '\r'
+inline block_masks classify(char const* p) noexcept
+{
+#if REGLEX_SIMD_WIDTH == 32
+    auto const v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p));
+    auto const nl = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'));
+    auto const sp = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+    // Unsigned (v - '\t') <= 4 covers '\t', '\n', '\v', '\f' and '\r'
+    auto const t = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+    auto const ctrl = _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(4)), t);
+    return {static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(sp, ctrl))),
+            static_cast<std::uint32_t>(_mm256_movemask_epi8(nl))};
+#else
+    auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+    auto const nl = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+    auto const sp = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    // Unsigned (v - '\t') <= 4 covers '\t', '\n', '\v', '\f' and '\r'
+    auto const t = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+    auto const ctrl = _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(4)), t);
+    return {static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_or_si128(sp, ctrl))),
+            static_cast<std::uint16_t>(_mm_movemask_epi8(nl))};
+#endif
+}
+
+// Mask of the bytes equal to c in one unaligned 64 byte block
+inline std::uint64_t byte_mask(char const* p, char c) noexcept
+{
+    std::uint64_t mask = 0;
+    for (std::size_t k = 0; k < 64; k += width)
+    {
+#if REGLEX_SIMD_WIDTH == 32
+        auto const v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p + k));
+        auto const bits = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c))));
+#else
+        auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + k));
+        auto const bits = static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c))));
+#endif
+        mask |= std::uint64_t{bits} << k;
+    }
+    return mask;
+}
+
+// Mask of the newlines in one unaligned 64 byte block
+inline std::uint64_t newline_mask(char const* p) noexcept
+{
+    return byte_mask(p, '\n');
+}
+#endif
+
+// Writes a newline bit mask for every 64 bytes of data into out, the final mask covers any
+// remaining bytes
+inline void newline_masks(char const* data, std::size_t size, std::uint64_t* out) noexcept
+{
+    std::size_t i = 0;
+#if defined(REGLEX_SIMD_WIDTH)
+    for (; i + 64 <= size; i += 64)
+    {
+        *out++ = newline_mask(data + i);
+    }
+#endif
+    for (; i < size; i += 64)
+    {
+        std::uint64_t mask = 0;
+        for (std::size_t k = 0; k < 64 && i + k < size; ++k)
+        {
+            mask |= std::uint64_t{data[i + k] == '\n'} << k;
+        }
+        *out++ = mask;
+    }
+}
+
+// Calls f with the index of every byte equal to c, in order
+template <typename F>
+inline void for_each_byte(char const* data, std::size_t size, char c, F&& f)
+{
+    std::size_t i = 0;
+#if defined(REGLEX_SIMD_WIDTH)
+    for (; i + 64 <= size; i += 64)
+    {
+        for (auto mask = byte_mask(data + i, c); mask; mask &= mask - 1)
+        {
+            f(i + static_cast<std::size_t>(__builtin_ctzll(mask)));
+        }
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        if (data[i] == c) f(i);
+    }
+}
+
+inline bool is_space(char c) noexcept
+{
+    return c == ' ' || static_cast<unsigned char>(c - '\t') <= 4;
+}
+
+// Length of the leading whitespace run, adding the newlines within it to lines
+inline std::size_t skip_whitespace(char const* data, std::size_t size, std::size_t& lines) noexcept
+{
+    std::size_t i = 0;
+#if defined(REGLEX_SIMD_WIDTH)
+    for (; i + width <= size; i += width)
+    {
+        auto const masks = classify(data + i);
+        auto const stop = ~masks.whitespace & full_block;
+        if (stop)
+        {
+            auto const n = static_cast<std::size_t>(__builtin_ctzll(stop));
+            lines += static_cast<std::size_t>(__builtin_popcountll(masks.newline & ((std::uint64_t{1} << n) - 1)));
+            return i + n;
+        }
+        lines += static_cast<std::size_t>(__builtin_popcountll(masks.newline));
+    }
+#endif
+    for (; i < size && is_space(data[i]); ++i)
+    {
+        lines += data[i] == '\n';
+    }
+    return i;
+}
+} // namespace simd
+} // namespace detail
+} // namespace REGLEX_NAMESPACE
+
+#endif // REGLEX_SIMD_H
@@ -0,0 +1,132 @@
+#pragma once
+#if !defined(REGLEX_SOA_H)
+#define REGLEX_SOA_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <reglex/reglex.hpp>
+
+namespace REGLEX_NAMESPACE
+{
+/// Token stream stored as parallel arrays, one entry per token in each. Passes which only look at
+/// token kinds walk a dense array of types, and searching for one kind is a vector compare when the
+/// enum is a single byte. Offsets and lines are 32 bits, so sources are limited to 4GiB.
+template <typename TokenType>
+struct LexedSoA
+{
+    using token_type_t = TokenType;
+
+    std::vector<token_type_t> types;
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint32_t> lengths;
+    // Zero based line of the first character of each token
+    std::vector<std::uint32_t> lines;
+    std::string_view remainder;
+    std::string_view source;
+
+    std::size_t size() const noexcept { return types.size(); }
+
+    void reserve(std::size_t n)
+    {
+        types.reserve(n);
+        offsets.reserve(n);
+        lengths.reserve(n);
+        lines.reserve(n);
+    }
+
+    void push_back(token_type_t type, std::size_t offset, std::size_t length, std::size_t line)
+    {
+        types.push_back(type);
+        offsets.push_back(static_cast<std::uint32_t>(offset));
+        lengths.push_back(static_cast<std::uint32_t>(length));
+        lines.push_back(static_cast<std::uint32_t>(line));
+    }
+
+    std::string_view lexeme(std::size_t i) const noexcept { return source.substr(offsets[i], lengths[i]); }
+
+    /// Full token at index i
+    Token<token_type_t> operator[](std::size_t i) const noexcept
+    {
+        auto const lex = lexeme(i);
+        return {types[i], lex, lines[i], static_cast<std::size_t>(std::count(lex.begin(), lex.end(), '\n'))};
+    }
+
+    /// Calls f with the index of every token of the given type, in order
+    template <typename F>
+    void for_each_of(token_type_t type, F&& f) const
+    {
+        if constexpr (sizeof(token_type_t) == 1)
+        {
+            detail::simd::for_each_byte(
+                reinterpret_cast<char const*>(types.data()), types.size(), static_cast<char>(type), f);
+        }
+        else
+        {
+            for (std::size_t i = 0; i < types.size(); ++i)
+            {
+                if (types[i] == type) f(i);
+            }
+        }
+    }
+
+    /// Number of tokens of the given type
+    std::size_t count(token_type_t type) const
+    {
+        std::size_t n = 0;
+        for_each_of(type, [&n](std::size_t) { ++n; });
+        return n;
+    }
+};
+
+/// Converts a lexed token vector of either layout into parallel arrays
+template <typename T, typename Allocator>
+LexedSoA<typename T::token_type_t> to_soa(Lexed<T, Allocator> const& lexed)
+{
+    LexedSoA<typename T::token_type_t> res;
+    res.source = lexed.source;
+    res.remainder = lexed.remainder;
+    res.reserve(lexed.tokens.size());
+    for (auto const& tok : lexed.tokens)
+    {
+        res.push_back(tok.type, lexed.offset(tok), lexed.lexeme(tok).size(), lexed.first_line(tok));
+    }
+    return res;
+}
+
+namespace detail
+{
+// Sink filling parallel arrays, whose offsets can't address past 4GiB
+template <typename TokenType>
+struct soa_sink : sink_base
+{
+    explicit soa_sink(LexedSoA<TokenType>& lexed) noexcept : out(lexed) {}
+
+    bool fits(std::size_t start, std::size_t length) const noexcept { return fits_32(start, length); }
+
+    bool emit(TokenType type, std::size_t start, std::string_view lexeme, std::size_t first_line, std::size_t)
+    {
+        out.push_back(type, start, lexeme.size(), first_line);
+        return true;
+    }
+
+    LexedSoA<TokenType>& out;
+};
+} // namespace detail
+
+/// Lexes straight into parallel arrays, without an intermediate token vector
+template <typename Traits>
+LexedSoA<typename Traits::token_type_t> lex_soa(std::string_view source)
+{
+    LexedSoA<typename Traits::token_type_t> res;
+    res.source = source;
+    detail::soa_sink<typename Traits::token_type_t> sink(res);
+    auto const stop = detail::drive<Traits>(source, 0, source.size(), 0, sink);
+    res.remainder = source.substr(stop.offset);
+    return res;
+}
+} // namespace REGLEX_NAMESPACE
+
+#endif // REGLEX_SOA_H
@@ -0,0 +1,246 @@
+#pragma once
+#if !defined(REGLEX_STATS_H)
+#define REGLEX_STATS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <reglex/reglex.hpp>
+
+namespace REGLEX_NAMESPACE
+{
+namespace detail
+{
+// Counters of one grammar, one slot per match index with the last for input nothing matched. Each
+// thread only writes its own, relaxed atomics let a report read them while lexing continues.
+template <std::size_t N>
+struct stats_counters
+{
+    std::array<std::atomic<std::uint64_t>, N> matches{};
+    std::array<std::atomic<std::uint64_t>, N> bytes{};
+    std::array<std::atomic<std::uint64_t>, N> failed{};
+    std::array<std::atomic<std::uint64_t>, N> cycles{};
+};
+
+inline void stats_add(std::atomic<std::uint64_t>& counter, std::uint64_t n) noexcept
+{
+    // Only the owning thread writes, so this needn't be a locked add
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// The counters of every live thread for one grammar, and the totals of threads which have exited
+template <std::size_t N>
+struct stats_registry
+{
+    std::mutex mutex;
+    std::vector<stats_counters<N>*> live;
+    stats_counters<N> retired;
+};
+
+template <typename Traits>
+stats_registry<Traits::token_count + 1>& stats_registry_of()
+{
+    static stats_registry<Traits::token_count + 1> registry;
+    return registry;
+}
+
+// Counters of the calling thread, registered on first use and folded into the retired totals when
+// the thread exits
+template <typename Traits>
+struct stats_slot
+{
+    static constexpr std::size_t N = Traits::token_count + 1;
+
+    stats_registry<N>& registry = stats_registry_of<Traits>();
+    stats_counters<N> counters;
+
+    stats_slot()
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.live.push_back(&counters);
+    }
+
+    stats_slot(stats_slot const&) = delete;
+    stats_slot& operator=(stats_slot const&) = delete;
+
+    ~stats_slot()
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            registry.retired.matches[i] += counters.matches[i].load();
+            registry.retired.bytes[i] += counters.bytes[i].load();
+            registry.retired.failed[i] += counters.failed[i].load();
+            registry.retired.cycles[i] += counters.cycles[i].load();
+        }
+        registry.live.erase(std::find(registry.live.begin(), registry.live.end(), &counters));
+    }
+
+    static stats_counters<N>& local()
+    {
+        static thread_local stats_slot slot;
+        return slot.counters;
+    }
+};
+} // namespace detail
+
+/// Instrumentation policy which counts, per token type, the tokens matched, the bytes they cover
+/// and the attempts of its pattern which failed. Timed also totals the time from the end of the
+/// trivia to the token being decided, in rdtsc cycles on x86 and steady clock nanoseconds
+/// elsewhere. Failed attempts are only seen by the regex engine, the DFA engine tries every
+/// pattern at once. Counters are kept per thread, read them with stats_report.
+template <bool Timed = false>
+struct count_stats
+{
+    static constexpr bool enabled = true;
+    static constexpr bool timed = Timed;
+
+    static std::uint64_t now() noexcept
+    {
+        if constexpr (Timed)
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+        }
+        return 0;
+    }
+
+    template <typename Traits>
+    static void matched(std::size_t index, std::size_t length, std::uint64_t started) noexcept
+    {
+        auto& counters = detail::stats_slot<Traits>::local();
+        detail::stats_add(counters.matches[index], 1);
+        detail::stats_add(counters.bytes[index], length);
+        if constexpr (Timed) detail::stats_add(counters.cycles[index], now() - started);
+    }
+
+    template <typename Traits>
+    static void failed(std::size_t index) noexcept
+    {
+        detail::stats_add(detail::stats_slot<Traits>::local().failed[index], 1);
+    }
+};
+
+/// Totals for one token type
+template <typename TokenType>
+struct TokenStats
+{
+    TokenType type;
+    std::uint64_t matches = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t failed = 0;
+    // Zero unless the policy is timed
+    std::uint64_t cycles = 0;
+};
+
+/// Totals across all threads, in enum order, along with the scans where nothing matched
+template <typename TokenType>
+struct StatsReport
+{
+    std::vector<TokenStats<TokenType>> tokens;
+    std::uint64_t no_match = 0;
+    std::uint64_t no_match_cycles = 0;
+};
+
+/// Sums the counters of a grammar with an enabled instrumentation policy over every thread
+template <typename Traits>
+StatsReport<typename Traits::token_type_t> stats_report()
+{
+    static_assert(Traits::stats_t::enabled, "stats_report needs an instrumentation policy such as count_stats");
+    using tables = detail::tables<Traits>;
+    constexpr auto N = Traits::token_count + 1;
+    std::array<std::uint64_t, N> matches{}, bytes{}, failed{}, cycles{};
+    auto const add = [&](detail::stats_counters<N> const& c) {
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            matches[i] += c.matches[i].load(std::memory_order_relaxed);
+            bytes[i] += c.bytes[i].load(std::memory_order_relaxed);
+            failed[i] += c.failed[i].load(std::memory_order_relaxed);
+            cycles[i] += c.cycles[i].load(std::memory_order_relaxed);
+        }
+    };
+    auto& registry = detail::stats_registry_of<Traits>();
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        add(registry.retired);
+        for (auto const* counters : registry.live)
+        {
+            add(*counters);
+        }
+    }
+
+    StatsReport<typename Traits::token_type_t> report;
+    report.tokens.reserve(Traits::token_count);
+    for (std::size_t i = 0; i < Traits::token_count; ++i)
+    {
+        report.tokens.push_back({tables::types[i], matches[i], bytes[i], failed[i], cycles[i]});
+    }
+    report.no_match = matches[Traits::token_count];
+    report.no_match_cycles = cycles[Traits::token_count];
+    return report;
+}
+
+/// Zeroes the counters of a grammar. Counts made by threads lexing at the same time may be lost.
+template <typename Traits>
+void reset_stats()
+{
+    constexpr auto N = Traits::token_count + 1;
+    auto const zero = [](detail::stats_counters<N>& c) {
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            c.matches[i].store(0, std::memory_order_relaxed);
+            c.bytes[i].store(0, std::memory_order_relaxed);
+            c.failed[i].store(0, std::memory_order_relaxed);
+            c.cycles[i].store(0, std::memory_order_relaxed);
+        }
+    };
+    auto& registry = detail::stats_registry_of<Traits>();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    zero(registry.retired);
+    for (auto* counters : registry.live)
+    {
+        zero(*counters);
+    }
+}
+
+/// Writes a report as a table, the busiest types first. Types which were never matched or tried
+/// are left out.
+template <typename TokenType>
+void write_stats(std::ostream& os, StatsReport<TokenType> const& report)
+{
+    auto rows = report.tokens;
+    rows.erase(std::remove_if(rows.begin(), rows.end(), [](auto const& row) { return !row.matches && !row.failed; }),
+               rows.end());
+    std::stable_sort(rows.begin(), rows.end(), [](auto const& a, auto const& b) {
+        return a.cycles != b.cycles ? a.cycles > b.cycles : a.bytes > b.bytes;
+    });
+    os << std::left << std::setw(20) << "type" << std::right << std::setw(14) << "matches" << std::setw(14) << "bytes"
+       << std::setw(14) << "failed" << std::setw(16) << "cycles" << std::setw(12) << "cycles/tok" << "\n";
+    for (auto const& row : rows)
+    {
+        auto const name = magic_enum::enum_name(row.type);
+        os << std::left << std::setw(20) << std::string(name) << std::right << std::setw(14) << row.matches
+           << std::setw(14) << row.bytes << std::setw(14) << row.failed << std::setw(16) << row.cycles
+           << std::setw(12) << (row.matches ? row.cycles / row.matches : 0) << "\n";
+    }
+    os << "no match " << report.no_match << ", cycles " << report.no_match_cycles << "\n";
+}
+} // namespace REGLEX_NAMESPACE
+
+#endif // REGLEX_STATS_H
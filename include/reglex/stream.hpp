@@ -0,0 +1,187 @@
+#pragma once
+#if !defined(REGLEX_STREAM_H)
+#define REGLEX_STREAM_H
+
+#include <string>
+#include <string_view>
+
+#include <reglex/dfa.hpp>
+
+namespace REGLEX_NAMESPACE
+{
+/// Lexer over input which arrives in chunks, such as from a socket, pipe or block reader. Complete
+/// tokens are emitted as each chunk is fed, and a token which could still grow, such as an
+/// unterminated comment or string, is carried over to be finished by the next chunk. Only the
+/// carried token is buffered, so memory is bounded by the longest token rather than the input.
+///
+/// A token is complete once no pattern could extend it, which is decided by running a DFA for
+/// the grammar with its lookaheads dropped until it dies. Lookaheads may therefore see one byte
+/// past the end of a token, the grammar must otherwise be one the DFA engine accepts. Trivia split
+/// across chunks must skip as it would whole, as whitespace does.
+template <typename Traits>
+class StreamLexer
+{
+public:
+    using token_t = Token<typename Traits::token_type_t>;
+
+    /// Lexes the complete tokens available once chunk is appended, calling emit with each. Lexemes
+    /// point into the chunk or the carried buffer, so are only valid during the call. Once lexing
+    /// has failed chunks are dropped, so a stream which fails early isn't buffered to its end.
+    template <typename F>
+    void feed(std::string_view chunk, F&& emit)
+    {
+        if (failed_) return;
+        if (!carry_.empty() && !resume(chunk, emit)) return;
+        // Nothing is carried, so lex the chunk in place and only copy what is left of it
+        carry_.assign(chunk.substr(consume(chunk, false, emit)));
+    }
+
+    /// Lexes whatever is still carried as the end of the input, calling emit with each token.
+    /// Returns the input which could not be lexed, valid until the next feed. After a failure that
+    /// is only what was fed up to the end of the chunk it happened in.
+    template <typename F>
+    std::string_view finish(F&& emit)
+    {
+        carry_.erase(0, consume(carry_, true, emit));
+        return carry_;
+    }
+
+    /// Zero based line of the next unconsumed character
+    std::size_t line() const noexcept { return line_; }
+    /// Offset into the whole input of the next unconsumed character
+    std::size_t offset() const noexcept { return offset_; }
+    /// Bytes held over for the next chunk
+    std::size_t buffered() const noexcept { return carry_.size(); }
+    /// Set when the input contains something no pattern matches, as lex would stop there
+    bool failed() const noexcept { return failed_; }
+
+private:
+    // Sink emitting tokens, which unless this is the end of the input stops at the first token
+    // more input could change
+    template <typename F>
+    struct chunk_sink : detail::sink_base
+    {
+        chunk_sink(StreamLexer& owner, std::string_view chunk, bool at_end, F& emit) noexcept
+            : lexer(owner), src(chunk), final(at_end), emit_token(emit)
+        {
+        }
+
+        bool ready(std::size_t start) noexcept
+        {
+            auto const& dfa = detail::dfa<Traits, true>;
+            constexpr std::size_t classes = detail::make_dfa<Traits, true>::classes.count;
+            if (!final)
+            {
+                // Resume over a carried token from where the previous chunk left off
+                std::size_t state = dfa.start;
+                auto i = start;
+                if (start == 0 && lexer.dfa_pos_ != 0)
+                {
+                    state = lexer.dfa_state_;
+                    i = lexer.dfa_pos_;
+                }
+                for (; i < src.size() && state != dfa.dead; ++i)
+                {
+                    state = dfa.next[state * classes + dfa.byte_class[static_cast<unsigned char>(src[i])]];
+                }
+                if (state != dfa.dead)
+                {
+                    // Still growing at the end of the chunk, carry it from its first character
+                    lexer.dfa_state_ = state;
+                    lexer.dfa_pos_ = src.size() - start;
+                    return false;
+                }
+            }
+            lexer.dfa_pos_ = 0;
+            return true;
+        }
+
+        bool emit(typename token_t::token_type_t type,
+                  std::size_t,
+                  std::string_view lexeme,
+                  std::size_t first_line,
+                  std::size_t num_lines)
+        {
+            emit_token(token_t{type, lexeme, first_line, num_lines});
+            return true;
+        }
+
+        StreamLexer& lexer;
+        std::string_view src;
+        bool final;
+        F& emit_token;
+    };
+
+    // Finishes what is carried with as little of chunk as it takes, dropping that from the front
+    // of chunk. Returns false when the carry has taken the whole chunk, as it is still growing or
+    // lexing failed.
+    template <typename F>
+    bool resume(std::string_view& chunk, F& emit)
+    {
+        auto const held = carry_.size();
+        if (dfa_pos_ == 0)
+        {
+            // Only trivia is carried, which goes on into the chunk's own
+            if (Traits::skip_t::skip(chunk).length == chunk.size())
+            {
+                carry_.append(chunk);
+                return false;
+            }
+            line_ += Traits::skip_t::skip(carry_).lines;
+            offset_ += held;
+            carry_.clear();
+            return true;
+        }
+        // Only the bytes up to where the carried token's DFA dies are needed to finish it
+        auto const& dfa = detail::dfa<Traits, true>;
+        constexpr std::size_t classes = detail::make_dfa<Traits, true>::classes.count;
+        auto state = dfa_state_;
+        std::size_t used = 0;
+        for (; used < chunk.size() && state != dfa.dead; ++used)
+        {
+            state = dfa.next[state * classes + dfa.byte_class[static_cast<unsigned char>(chunk[used])]];
+        }
+        carry_.append(chunk.substr(0, used));
+        dfa_state_ = state;
+        dfa_pos_ = carry_.size();
+        if (state != dfa.dead) return false;
+        auto const consumed = consume(carry_, false, emit);
+        if (!failed_ && consumed >= held)
+        {
+            // Lexing stopped within the appended bytes, carry on from there in the chunk
+            chunk.remove_prefix(consumed - held);
+            carry_.clear();
+            return true;
+        }
+        // A token begun in the carry is still growing, so it keeps the rest of the chunk as well
+        carry_.erase(0, consumed);
+        carry_.append(chunk.substr(used));
+        if (!failed_) carry_.erase(0, consume(carry_, false, emit));
+        return false;
+    }
+
+    // Lexes src, returning how much of it was consumed. Trivia running to the end of the chunk may
+    // continue into the next one, at the end of the input it is left as the remainder, as lex does.
+    template <typename F>
+    std::size_t consume(std::string_view src, bool final, F& emit)
+    {
+        if (failed_) return 0;
+        chunk_sink<F> sink(*this, src, final, emit);
+        auto const stop = detail::drive<Traits>(src, 0, src.size(), line_, sink);
+        line_ = stop.line;
+        failed_ = stop.failed;
+        offset_ += stop.offset;
+        return stop.offset;
+    }
+
+    std::string carry_;
+    std::size_t line_ = 0;
+    std::size_t offset_ = 0;
+    // Progress of the DFA over the carried token, so that a long token is only walked once
+    std::size_t dfa_state_ = 0;
+    std::size_t dfa_pos_ = 0;
+    bool failed_ = false;
+};
+} // namespace REGLEX_NAMESPACE
+
+#endif // REGLEX_STREAM_H
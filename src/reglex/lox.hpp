@@ -0,0 +1,84 @@
+#pragma once
+#if !defined(REGLEX_LOX_H)
+#define REGLEX_LOX_H
+
+#include <cstdint>
+#include <reglex/reglex.hpp>
+
+// clang-format off
+enum class TokenType : uint8_t
+{
+    // Should be ignored.---------------------------------------------------------
+    COMMENT,
+    // Single-character tokens.---------------------------------------------------
+    LEFT_PAREN, RIGHT_PAREN, LEFT_BRACE, RIGHT_BRACE, LEFT_BRACKET, RIGHT_BRACKET,
+    COMMA, DOT, MINUS, PLUS, SEMICOLON, SLASH, STAR, QUESTION, COLON,
+    // One or two character tokens.-----------------------------------------------
+    BANG_EQUAL, BANG, EQUAL, GREATER_EQUAL, LESS_EQUAL, GREATER, LESS, ASSIGN,
+    // Keywords.
+    AND, STRUCT, ELSE, FUN, FOR, IF, NIL, OR, PRINT, RETURN, SUPER, THIS,
+    TRUE, FALSE, VAR, WHILE,
+    // Literals.-----------------------------------------------------------------
+    IDENTIFIER, STRING, NUMBER,
+    // Represents a lexical error.------------------------------------------------
+    ERROR,
+};
+// clang-format on
+
+struct Matcher : reglex::Matcher<TokenType>
+{
+};
+// clang-format off
+template<> constexpr std::string_view Matcher::pattern<TokenType::COMMENT> = reglex::cstyle_comment;
+template<> constexpr std::string_view Matcher::pattern<TokenType::LEFT_PAREN> = R"(\()";
+template<> constexpr std::string_view Matcher::pattern<TokenType::RIGHT_PAREN> = R"(\))";
+template<> constexpr std::string_view Matcher::pattern<TokenType::LEFT_BRACE> = R"(\{)";
+template<> constexpr std::string_view Matcher::pattern<TokenType::RIGHT_BRACE> = R"(\})";
+template<> constexpr std::string_view Matcher::pattern<TokenType::LEFT_BRACKET> = R"(\[)";
+template<> constexpr std::string_view Matcher::pattern<TokenType::RIGHT_BRACKET> = R"(\])";
+template<> constexpr std::string_view Matcher::pattern<TokenType::COMMA> = R"(,)";
+template<> constexpr std::string_view Matcher::pattern<TokenType::DOT> = R"(\.)";
+template<> constexpr std::string_view Matcher::pattern<TokenType::MINUS> = R"(\-)";
+template<> constexpr std::string_view Matcher::pattern<TokenType::PLUS> = R"(\+)";
+template<> constexpr std::string_view Matcher::pattern<TokenType::SEMICOLON> = R"(;)";
+template<> constexpr std::string_view Matcher::pattern<TokenType::SLASH> = R"(/)";
+template<> constexpr std::string_view Matcher::pattern<TokenType::STAR> = R"(\*)";
+template<> constexpr std::string_view Matcher::pattern<TokenType::QUESTION> = R"(\?)";
+template<> constexpr std::string_view Matcher::pattern<TokenType::COLON> = R"(:)";
+template<> constexpr std::string_view Matcher::pattern<TokenType::BANG_EQUAL> = R"(!=)";
+template<> constexpr std::string_view Matcher::pattern<TokenType::BANG> = R"(!)";
+template<> constexpr std::string_view Matcher::pattern<TokenType::EQUAL> = R"(==)";
+template<> constexpr std::string_view Matcher::pattern<TokenType::GREATER_EQUAL> = R"(>=)";
+template<> constexpr std::string_view Matcher::pattern<TokenType::LESS_EQUAL> = R"(<=)";
+template<> constexpr std::string_view Matcher::pattern<TokenType::GREATER> = R"(>)";
+template<> constexpr std::string_view Matcher::pattern<TokenType::LESS> = R"(<)";
+template<> constexpr std::string_view Matcher::pattern<TokenType::ASSIGN> = R"(=)";
+template<> constexpr std::string_view Matcher::keyword<TokenType::AND> = "and";
+template<> constexpr std::string_view Matcher::keyword<TokenType::STRUCT> = "struct";
+template<> constexpr std::string_view Matcher::keyword<TokenType::ELSE> = "else";
+template<> constexpr std::string_view Matcher::keyword<TokenType::FUN> = "fun";
+template<> constexpr std::string_view Matcher::keyword<TokenType::FOR> = "for";
+template<> constexpr std::string_view Matcher::keyword<TokenType::IF> = "if";
+template<> constexpr std::string_view Matcher::keyword<TokenType::NIL> = "nil";
+template<> constexpr std::string_view Matcher::keyword<TokenType::OR> = "or";
+template<> constexpr std::string_view Matcher::keyword<TokenType::PRINT> = "print";
+template<> constexpr std::string_view Matcher::keyword<TokenType::RETURN> = "return";
+template<> constexpr std::string_view Matcher::keyword<TokenType::SUPER> = "super";
+template<> constexpr std::string_view Matcher::keyword<TokenType::THIS> = "this";
+template<> constexpr std::string_view Matcher::keyword<TokenType::TRUE> = "true";
+template<> constexpr std::string_view Matcher::keyword<TokenType::FALSE> = "false";
+template<> constexpr std::string_view Matcher::keyword<TokenType::VAR> = "var";
+template<> constexpr std::string_view Matcher::keyword<TokenType::WHILE> = "while";
+template<> constexpr std::string_view Matcher::pattern<TokenType::IDENTIFIER> = reglex::identifier;
+template<> constexpr std::string_view Matcher::pattern<TokenType::STRING> = reglex::string;
+template<> constexpr std::string_view Matcher::pattern<TokenType::NUMBER> = reglex::real_number;
+template<> constexpr std::string_view Matcher::pattern<TokenType::ERROR> = reglex::non_whitespace_char;
+
+template<> constexpr bool Matcher::filter_out<TokenType::COMMENT> = true;
+template<> constexpr bool Matcher::has_keywords<TokenType::IDENTIFIER> = true;
+// clang-format on
+
+// Define the traits for the token
+using TokenTraits = reglex::LexTraits<TokenType, Matcher>;
+
+#endif // REGLEX_LOX_H
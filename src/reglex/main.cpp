@@ -1,99 +1,228 @@
-#include <fstream>
+#include <chrono>
+#include <memory>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
-#define REGLEX_USE_MACROS
-#include <reglex/reglex.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
 
-// clang-format off
-enum class TokenType : uint8_t
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <reglex/cache.hpp>
+#include <reglex/dfa.hpp>
+#include <reglex/dump.hpp>
+#include <reglex/files.hpp>
+
+#include "lox.hpp"
+
+namespace
 {
-    // Should be ignored.---------------------------------------------------------
-    COMMENT,
-    // Single-character tokens.---------------------------------------------------
-    LEFT_PAREN, RIGHT_PAREN, LEFT_BRACE, RIGHT_BRACE, LEFT_BRACKET, RIGHT_BRACKET,
-    COMMA, DOT, MINUS, PLUS, SEMICOLON, SLASH, STAR, QUESTION, COLON,
-    // One or two character tokens.-----------------------------------------------
-    BANG_EQUAL, BANG, EQUAL, GREATER_EQUAL, LESS_EQUAL, GREATER, LESS, ASSIGN,
-    // Keywords.
-    AND, STRUCT, ELSE, FUN, FOR, IF, NIL, OR, PRINT, RETURN, SUPER, THIS,
-    TRUE, FALSE, VAR, WHILE,
-    // Literals.-----------------------------------------------------------------
-    IDENTIFIER, STRING, NUMBER,
-    // Represents a lexical error.------------------------------------------------
-    ERROR,
+// More workers than this is a typo rather than a machine
+constexpr std::size_t max_threads = 1024;
+
+// The same grammar matched with a single compiled DFA
+struct DfaTokenTraits : TokenTraits
+{
+    using engine_t = reglex::dfa_engine;
 };
-// clang-format on
 
-struct Matcher : reglex::Matcher<TokenType>
+struct Options
 {
+    std::vector<std::string> paths;
+    std::string engine = "regex";
+    std::size_t threads = 0;
+    reglex::DumpFormat format = reglex::DumpFormat::Text;
+    std::string cache;
+    std::uint64_t cache_size = reglex::LexCache::default_max_bytes;
+    bool quiet = false;
+    bool stats = false;
 };
-// clang-format off
-template<> constexpr std::string_view Matcher::pattern<TokenType::COMMENT> = reglex::cstyle_comment;
-template<> constexpr std::string_view Matcher::pattern<TokenType::LEFT_PAREN> = R"(\()";
-template<> constexpr std::string_view Matcher::pattern<TokenType::RIGHT_PAREN> = R"(\))";
-template<> constexpr std::string_view Matcher::pattern<TokenType::LEFT_BRACE> = R"(\{)";
-template<> constexpr std::string_view Matcher::pattern<TokenType::RIGHT_BRACE> = R"(\})";
-template<> constexpr std::string_view Matcher::pattern<TokenType::LEFT_BRACKET> = R"(\[)";
-template<> constexpr std::string_view Matcher::pattern<TokenType::RIGHT_BRACKET> = R"(\])";
-template<> constexpr std::string_view Matcher::pattern<TokenType::COMMA> = R"(,)";
-template<> constexpr std::string_view Matcher::pattern<TokenType::DOT> = R"(\.)";
-template<> constexpr std::string_view Matcher::pattern<TokenType::MINUS> = R"(\-)";
-template<> constexpr std::string_view Matcher::pattern<TokenType::PLUS> = R"(\+)";
-template<> constexpr std::string_view Matcher::pattern<TokenType::SEMICOLON> = R"(;)";
-template<> constexpr std::string_view Matcher::pattern<TokenType::SLASH> = R"(/)";
-template<> constexpr std::string_view Matcher::pattern<TokenType::STAR> = R"(\*)";
-template<> constexpr std::string_view Matcher::pattern<TokenType::QUESTION> = R"(\?)";
-template<> constexpr std::string_view Matcher::pattern<TokenType::COLON> = R"(:)";
-template<> constexpr std::string_view Matcher::pattern<TokenType::BANG_EQUAL> = R"(!=)";
-template<> constexpr std::string_view Matcher::pattern<TokenType::BANG> = R"(!)";
-template<> constexpr std::string_view Matcher::pattern<TokenType::EQUAL> = R"(==)";
-template<> constexpr std::string_view Matcher::pattern<TokenType::GREATER_EQUAL> = R"(>=)";
-template<> constexpr std::string_view Matcher::pattern<TokenType::LESS_EQUAL> = R"(<=)";
-template<> constexpr std::string_view Matcher::pattern<TokenType::GREATER> = R"(>)";
-template<> constexpr std::string_view Matcher::pattern<TokenType::LESS> = R"(<)";
-template<> constexpr std::string_view Matcher::pattern<TokenType::ASSIGN> = R"(=)";
-template<> constexpr std::string_view Matcher::pattern<TokenType::AND> = REGLEX_KEYWORD("and");
-template<> constexpr std::string_view Matcher::pattern<TokenType::STRUCT> = REGLEX_KEYWORD("struct");
-template<> constexpr std::string_view Matcher::pattern<TokenType::ELSE> = REGLEX_KEYWORD("else");
-template<> constexpr std::string_view Matcher::pattern<TokenType::FUN> = REGLEX_KEYWORD("fun");
-template<> constexpr std::string_view Matcher::pattern<TokenType::FOR> = REGLEX_KEYWORD("for");
-template<> constexpr std::string_view Matcher::pattern<TokenType::IF> = REGLEX_KEYWORD("if");
-template<> constexpr std::string_view Matcher::pattern<TokenType::NIL> = REGLEX_KEYWORD("nil");
-template<> constexpr std::string_view Matcher::pattern<TokenType::OR> = REGLEX_KEYWORD("or");
-template<> constexpr std::string_view Matcher::pattern<TokenType::PRINT> = REGLEX_KEYWORD("print");
-template<> constexpr std::string_view Matcher::pattern<TokenType::RETURN> = REGLEX_KEYWORD("return");
-template<> constexpr std::string_view Matcher::pattern<TokenType::SUPER> = REGLEX_KEYWORD("super");
-template<> constexpr std::string_view Matcher::pattern<TokenType::THIS> = REGLEX_KEYWORD("this");
-template<> constexpr std::string_view Matcher::pattern<TokenType::TRUE> = REGLEX_KEYWORD("true");
-template<> constexpr std::string_view Matcher::pattern<TokenType::FALSE> = REGLEX_KEYWORD("false");
-template<> constexpr std::string_view Matcher::pattern<TokenType::VAR> = REGLEX_KEYWORD("var");
-template<> constexpr std::string_view Matcher::pattern<TokenType::WHILE> = REGLEX_KEYWORD("while");
-template<> constexpr std::string_view Matcher::pattern<TokenType::IDENTIFIER> = reglex::identifier;
-template<> constexpr std::string_view Matcher::pattern<TokenType::STRING> = reglex::string;
-template<> constexpr std::string_view Matcher::pattern<TokenType::NUMBER> = reglex::real_number;
-template<> constexpr std::string_view Matcher::pattern<TokenType::ERROR> = reglex::non_whitespace;
 
-template<> constexpr bool Matcher::filter_out<TokenType::COMMENT> = true;
-// clang-format on
+void usage()
+{
+    std::cerr << "usage: reglex [options] [paths...]\n"
+                 "  --engine NAME  regex or dfa, how token patterns are matched\n"
+                 "  --threads N    worker threads up to 1024, zero for the hardware concurrency\n"
+                 "  --format NAME  text, tsv or binary, how tokens are printed\n"
+                 "  --cache DIR    load unchanged files' tokens from DIR, storing the rest\n"
+                 "  --cache-size N cap on the cache directory in MiB, least recently used go first\n"
+                 "  --quiet        lex without printing the tokens\n"
+                 "  --stats        print per file and batch timings, throughput and peak memory to stderr\n"
+                 "With no paths test.lox is lexed.\n";
+}
+
+// False after printing why the arguments were not understood
+bool parse(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view const arg = argv[i];
+        if (arg == "--quiet") options.quiet = true;
+        else if (arg == "--stats") options.stats = true;
+        else if (arg == "--engine" || arg == "--threads" || arg == "--format" || arg == "--cache" ||
+                 arg == "--cache-size")
+        {
+            if (i + 1 == argc)
+            {
+                std::cerr << "missing value for " << arg << "\n";
+                return false;
+            }
+            std::string_view const value = argv[++i];
+            if (arg == "--engine")
+            {
+                if (value != "regex" && value != "dfa")
+                {
+                    std::cerr << "unknown engine " << value << "\n";
+                    return false;
+                }
+                options.engine = value;
+                continue;
+            }
+            if (arg == "--format")
+            {
+                if (value == "text") options.format = reglex::DumpFormat::Text;
+                else if (value == "tsv") options.format = reglex::DumpFormat::Tsv;
+                else if (value == "binary") options.format = reglex::DumpFormat::Binary;
+                else
+                {
+                    std::cerr << "unknown format " << value << "\n";
+                    return false;
+                }
+                continue;
+            }
+            if (arg == "--cache")
+            {
+                options.cache = value;
+                continue;
+            }
+            // Digits only, strtoull would take a sign and wrap a negative count around
+            auto const n = std::strtoull(argv[i], nullptr, 10);
+            auto const limit = arg == "--threads" ? std::uint64_t{max_threads} : UINT64_MAX >> 20;
+            if (value.empty() || value.find_first_not_of("0123456789") != std::string_view::npos || n > limit)
+            {
+                std::cerr << "bad value " << value << " for " << arg << ", expected 0 to " << limit << "\n";
+                return false;
+            }
+            if (arg == "--threads") options.threads = n;
+            else options.cache_size = std::uint64_t{n} << 20;
+        }
+        else if (arg == "--help")
+        {
+            usage();
+            std::exit(0);
+        }
+        else if (arg.size() > 1 && arg.front() == '-')
+        {
+            std::cerr << "unknown option " << arg << "\n";
+            usage();
+            return false;
+        }
+        else options.paths.emplace_back(arg);
+    }
+    if (options.paths.empty()) options.paths.emplace_back("test.lox");
+    return true;
+}
+
+double milliseconds(std::chrono::nanoseconds time)
+{
+    return std::chrono::duration<double, std::milli>(time).count();
+}
 
-// Define the traits for the token
-using TokenTraits = reglex::LexTraits<TokenType, Matcher>;
+// Largest resident set of the process so far, in bytes
+std::size_t peak_rss()
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
 
-int main()
+template <typename Traits>
+int run(Options const& options)
 {
-    std::ifstream file("test.lox");
-    if (!file.is_open())
+    using clock = std::chrono::steady_clock;
+    reglex::LexFilesOptions lex_options;
+    lex_options.threads = options.threads;
+    std::unique_ptr<reglex::LexCache> cache;
+    if (!options.cache.empty())
+    {
+        cache = std::make_unique<reglex::LexCache>(options.cache, options.cache_size);
+        lex_options.cache = cache.get();
+    }
+    auto const start = clock::now();
+    auto const results = reglex::lex_files<Traits>(options.paths, lex_options);
+    auto const lexed = clock::now();
+
+    int status = 0;
+    reglex::TokenWriter writer(STDOUT_FILENO, options.format);
+    std::size_t bytes = 0;
+    std::size_t tokens = 0;
+    std::chrono::nanoseconds read_time{0};
+    std::chrono::nanoseconds lex_time{0};
+    for (auto const& res : results)
+    {
+        if (!res.ok)
+        {
+            std::cerr << "Failed to open " << res.path << "\n";
+            status = 1;
+            continue;
+        }
+        bytes += res.lexed.source.size();
+        tokens += res.lexed.tokens.size();
+        read_time += res.load_time;
+        lex_time += res.lex_time;
+        // Sources are named so a dump of several can be split up again, a lone text dump is left
+        // plain
+        auto const name = options.format == reglex::DumpFormat::Text && options.paths.size() == 1
+                              ? std::string_view{}
+                              : std::string_view{res.path};
+        if (!options.quiet) writer.write<Traits>(res.lexed, name);
+    }
+    if (!writer.flush())
     {
-        std::cout << "Failed to open file.\n";
-        return 1;
+        std::cerr << "Failed to write tokens\n";
+        status = 1;
     }
-    using source_iter = std::istreambuf_iterator<char>;
-    std::string const source{source_iter(file), source_iter{}};
+    auto const done = clock::now();
 
-    auto const res = reglex::lex<TokenTraits>(source);
-    for (auto const& tok : res.tokens)
+    if (options.stats)
     {
-        std::cout << magic_enum::enum_name(tok.type) << " " << tok.first_line << "\n";
+        // Throughput is over the wall time of the whole batch, the phase times are summed across
+        // files and so across threads. Mapped files are paged in as they are lexed, so most of the
+        // cost of reading shows up as lexing.
+        for (auto const& res : results)
+        {
+            if (!res.ok) continue;
+            std::cerr << res.path << " " << res.lexed.tokens.size() << " tokens, load " << milliseconds(res.load_time)
+                      << " ms, lex " << milliseconds(res.lex_time) << " ms\n";
+        }
+        auto const seconds = std::chrono::duration<double>(lexed - start).count();
+        std::cerr << results.size() << " files, " << bytes << " bytes, " << tokens << " tokens, engine "
+                  << options.engine << "\n"
+                  << "throughput " << static_cast<double>(bytes) / 1e6 / seconds << " MB/s, "
+                  << static_cast<double>(tokens) / seconds << " tokens/s\n"
+                  << "read " << milliseconds(read_time) << " ms, lex " << milliseconds(lex_time) << " ms, batch "
+                  << milliseconds(lexed - start) << " ms, output " << milliseconds(done - lexed) << " ms\n"
+                  << "peak rss " << static_cast<double>(peak_rss()) / (1 << 20) << " MiB\n";
+        if (cache)
+        {
+            std::cerr << "cache " << cache->hits() << " hits, " << cache->misses() << " misses, "
+                      << static_cast<double>(cache->size()) / (1 << 20) << " MiB\n";
+        }
     }
-    return 0;
+    return status;
 }
+} // namespace
 
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parse(argc, argv, options)) return 1;
+    if (options.engine == "dfa") return run<DfaTokenTraits>(options);
+    return run<TokenTraits>(options);
+}
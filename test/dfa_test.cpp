@@ -0,0 +1,57 @@
+// The DFA engine against the regex engine picking the longest match, which it must agree with on
+// any grammar it accepts, and both against lex
+
+#include <reglex/dfa.hpp>
+
+#include "test/differential.hpp"
+
+// A class range bounded by hex escapes, whose last digit once read as a class escape
+enum class Escaped
+{
+    CONTROL,
+    WORD
+};
+
+struct EscapedMatcher : reglex::Matcher<Escaped>
+{
+};
+template <>
+constexpr std::string_view EscapedMatcher::pattern<Escaped::CONTROL> = R"([\x0d-\x1f]+)";
+template <>
+constexpr std::string_view EscapedMatcher::pattern<Escaped::WORD> = R"([a-z]+)";
+
+struct EscapedTraits : reglex::LexTraits<Escaped, EscapedMatcher>
+{
+    using engine_t = reglex::dfa_engine;
+};
+
+namespace
+{
+struct LongestTraits : TokenTraits
+{
+    static constexpr bool longest_match = true;
+};
+
+struct DfaTraits : TokenTraits
+{
+    using engine_t = reglex::dfa_engine;
+};
+} // namespace
+
+int main()
+{
+    using namespace differential;
+    auto const escaped = reglex::lex<EscapedTraits>("ab\x10\x1e\x0e" "cd");
+    if (escaped.tokens.size() != 3 || escaped.tokens[1].lexeme != "\x10\x1e\x0e")
+    {
+        fail("hex escape range in a class");
+    }
+    for (std::size_t i = 0; i < sources().size(); ++i)
+    {
+        auto const& source = sources()[i];
+        auto const longest = seen(reglex::lex<LongestTraits>(source.text));
+        expect_same(longest, seen(reglex::lex<DfaTraits>(source.text)), source.name + " dfa_engine");
+        expect_same(expected()[i], longest, source.name + " longest_match");
+    }
+    return status();
+}
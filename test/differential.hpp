@@ -0,0 +1,134 @@
+#pragma once
+#if !defined(REGLEX_TEST_DIFFERENTIAL_H)
+#define REGLEX_TEST_DIFFERENTIAL_H
+
+// Shared pieces of the differential tests, which check a lexing path against lex over generated
+// programs. A test reports each mismatch with fail and exits with status().
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <reglex/reglex.hpp>
+
+#include "src/reglex/lox.hpp"
+#include "tools/corpus.hpp"
+
+namespace differential
+{
+inline int failures = 0;
+
+inline void fail(std::string const& what)
+{
+    std::fprintf(stderr, "FAIL %s\n", what.c_str());
+    ++failures;
+}
+
+inline int status()
+{
+    if (failures) std::fprintf(stderr, "%d failures\n", failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// A token as seen from outside, so streams of any layout or buffer can be compared
+struct Seen
+{
+    TokenType type;
+    std::size_t offset;
+    std::string lexeme;
+    std::size_t first_line;
+    std::size_t num_lines;
+
+    bool operator==(Seen const& other) const
+    {
+        return type == other.type && offset == other.offset && lexeme == other.lexeme &&
+               first_line == other.first_line && num_lines == other.num_lines;
+    }
+};
+
+struct Tokens
+{
+    std::vector<Seen> tokens;
+    std::string remainder;
+};
+
+template <typename Lexed>
+Tokens seen(Lexed const& lexed)
+{
+    Tokens out;
+    for (auto const& tok : lexed.tokens)
+    {
+        auto const view = lexed.view(tok);
+        out.tokens.push_back({view.type, lexed.offset(tok), std::string(view.lexeme), view.first_line, view.num_lines});
+    }
+    out.remainder = std::string(lexed.remainder);
+    return out;
+}
+
+inline void expect_same(Tokens const& expected, Tokens const& actual, std::string const& what)
+{
+    if (expected.tokens.size() != actual.tokens.size())
+    {
+        return fail(what + ": " + std::to_string(actual.tokens.size()) + " tokens, expected " +
+                    std::to_string(expected.tokens.size()));
+    }
+    for (std::size_t i = 0; i < expected.tokens.size(); ++i)
+    {
+        if (!(expected.tokens[i] == actual.tokens[i]))
+        {
+            return fail(what + ": token " + std::to_string(i) + " at offset " +
+                        std::to_string(expected.tokens[i].offset) + " differs");
+        }
+    }
+    if (expected.remainder != actual.remainder) fail(what + ": remainder differs");
+}
+
+struct Source
+{
+    std::string name;
+    std::string text;
+};
+
+// Ordinary and adversarial programs of 1MiB on a few seeds, and one cut off a third of the way in
+// so inputs also end inside comments and strings
+inline std::vector<Source> const& sources()
+{
+    static std::vector<Source> const all = [] {
+        std::vector<Source> out;
+        for (std::uint64_t seed : {1, 2, 3})
+        {
+            out.push_back({"realistic/" + std::to_string(seed), corpus::generate(corpus::realistic(seed, 1 << 20))});
+            out.push_back(
+                {"adversarial/" + std::to_string(seed), corpus::generate(corpus::adversarial(seed, 1 << 20))});
+        }
+        out.push_back({"truncated", out[1].text.substr(0, out[1].text.size() / 3)});
+        return out;
+    }();
+    return all;
+}
+
+// What lex makes of each source, the reference every other path is held to
+inline std::vector<Tokens> const& expected()
+{
+    static std::vector<Tokens> const all = [] {
+        std::vector<Tokens> out;
+        for (auto const& source : sources())
+        {
+            out.push_back(seen(reglex::lex<TokenTraits>(source.text)));
+        }
+        return out;
+    }();
+    return all;
+}
+
+// Scratch directory, Bazel's when run as a test
+inline std::string temp_dir()
+{
+    if (auto const* dir = std::getenv("TEST_TMPDIR")) return dir;
+    return "/tmp";
+}
+} // namespace differential
+
+#endif // REGLEX_TEST_DIFFERENTIAL_H
@@ -0,0 +1,62 @@
+// lex_files against lex over the generated sources written out as files, split into chunk tasks
+// at a page and at the smallest parallel split, and the work stealing pool it runs on
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include <reglex/files.hpp>
+
+#include "test/differential.hpp"
+
+int main()
+{
+    using namespace differential;
+    std::vector<std::string> paths;
+    for (std::size_t i = 0; i < sources().size(); ++i)
+    {
+        paths.push_back(temp_dir() + "/files_test_" + std::to_string(i) + ".lox");
+        std::ofstream(paths.back(), std::ios::binary) << sources()[i].text;
+    }
+    for (std::size_t split : {4096, 1 << 16})
+    {
+        reglex::LexFilesOptions options;
+        options.threads = 4;
+        options.split_size = split;
+        auto const results = reglex::lex_files<TokenTraits>(paths, options);
+        for (std::size_t i = 0; i < sources().size(); ++i)
+        {
+            auto const what = sources()[i].name + " lex_files split at " + std::to_string(split);
+            if (!results[i].ok) fail(what + ": not read");
+            else expect_same(expected()[i], seen(results[i].lexed), what);
+        }
+    }
+    for (auto const& path : paths)
+    {
+        std::remove(path.c_str());
+    }
+
+    // A throwing task leaves the workers running and the rest of the batch to finish
+    reglex::detail::work_stealing_pool pool(4);
+    std::atomic<int> ran{0};
+    for (int i = 0; i < 64; ++i)
+    {
+        pool.submit([&ran, i] {
+            if (i % 16 == 3) throw std::runtime_error("task");
+            ++ran;
+        });
+    }
+    try
+    {
+        pool.wait();
+        fail("work_stealing_pool dropped a task's exception");
+    }
+    catch (std::runtime_error const&)
+    {
+    }
+    if (ran != 60) fail("work_stealing_pool ran " + std::to_string(ran) + " of 60 tasks");
+    pool.submit([&ran] { ++ran; });
+    pool.wait();
+    if (ran != 61) fail("work_stealing_pool stopped after an exception");
+    return status();
+}
@@ -0,0 +1,68 @@
+// relex and apply against lexing the edited source whole, under random small edits which often
+// open or close comments and strings, keeping resync points current as they go
+
+#include <algorithm>
+#include <iterator>
+
+#include <reglex/incremental.hpp>
+
+#include "test/differential.hpp"
+
+namespace
+{
+struct CompactTraits : TokenTraits
+{
+    using token_t = reglex::CompactToken<TokenType>;
+};
+
+template <typename Traits>
+void check(differential::Source const& source, std::string const& layout)
+{
+    using namespace differential;
+    static constexpr std::string_view inserts[] = {
+        "", "a", "/*", "*/", "\"", "\n", "var x = 10;\n", "/* c\n */", "or", " ", "1.5", "//", "\"x\ny\""};
+    corpus::Random random(source.text.size());
+    std::string text = source.text.substr(0, 64 << 10);
+    auto lexed = reglex::lex<Traits>(text);
+    auto points = reglex::resync_points<Traits>(lexed, 512);
+    for (std::size_t i = 0; i < 200; ++i)
+    {
+        reglex::Edit edit;
+        edit.offset = random.below(text.size() + 1);
+        edit.removed = std::min<std::size_t>(random.below(5), text.size() - edit.offset);
+        auto const insert = inserts[random.below(std::size(inserts))];
+        auto edited = text.substr(0, edit.offset) + std::string(insert) + text.substr(edit.offset + edit.removed);
+        edit.inserted = std::string_view(edited).substr(edit.offset, insert.size());
+        auto const diff = reglex::relex<Traits>(lexed, edited, edit, points);
+        reglex::apply<Traits>(lexed, edited, diff, points);
+        // The tokens view edited, which keeps its buffer when swapped
+        text.swap(edited);
+        auto const what = source.name + layout + " relex edit " + std::to_string(i);
+        auto const before = failures;
+        auto const expected = reglex::lex<Traits>(text);
+        expect_same(seen(expected), seen(lexed), what);
+        // Every point kept must be one a fresh search could have picked
+        auto const all = reglex::resync_points<Traits>(expected, 1);
+        for (auto const offset : points.offsets)
+        {
+            if (!std::binary_search(all.offsets.begin(), all.offsets.end(), offset))
+            {
+                fail(what + ": bad resync point " + std::to_string(offset));
+                break;
+            }
+        }
+        // Later edits build on this one, so stop at the first mismatch
+        if (failures != before) return;
+    }
+}
+} // namespace
+
+int main()
+{
+    for (auto const& source : differential::sources())
+    {
+        check<TokenTraits>(source, "");
+        check<CompactTraits>(source, " compact");
+    }
+    return differential::status();
+}
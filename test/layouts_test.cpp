@@ -0,0 +1,106 @@
+// Every way of lexing one source in a single pass against lex, in both token layouts: into a
+// buffer a few tokens at a time, through token_range, and into parallel arrays
+
+#include <algorithm>
+#include <vector>
+
+#include <reglex/soa.hpp>
+
+#include "test/differential.hpp"
+
+namespace
+{
+struct CompactTraits : TokenTraits
+{
+    using token_t = reglex::CompactToken<TokenType>;
+};
+
+// Lexes into a small buffer, resuming from where each call stopped
+template <typename Traits>
+differential::Tokens buffered(std::string_view source)
+{
+    using token_t = typename Traits::token_t;
+    differential::Tokens out;
+    std::vector<token_t> buffer(7);
+    std::size_t at = 0;
+    std::size_t line = 0;
+    for (;;)
+    {
+        auto const rest = source.substr(at);
+        auto const written = reglex::lex<Traits>(rest, buffer.data(), buffer.data() + buffer.size(), line);
+        for (std::size_t k = 0; k < written.count; ++k)
+        {
+            auto const& tok = buffer[k];
+            if constexpr (reglex::detail::is_compact_token<token_t>::value)
+            {
+                // Compact offsets are relative to rest, with lines counted from where it begins
+                auto const lexeme = rest.substr(tok.offset, tok.length);
+                auto const before = rest.substr(0, tok.offset);
+                out.tokens.push_back({tok.type,
+                                      at + tok.offset,
+                                      std::string(lexeme),
+                                      line + static_cast<std::size_t>(std::count(before.begin(), before.end(), '\n')),
+                                      static_cast<std::size_t>(std::count(lexeme.begin(), lexeme.end(), '\n'))});
+            }
+            else
+            {
+                out.tokens.push_back({tok.type,
+                                      static_cast<std::size_t>(tok.lexeme.data() - source.data()),
+                                      std::string(tok.lexeme),
+                                      tok.first_line,
+                                      tok.num_lines});
+            }
+        }
+        at += written.offset;
+        line = written.line;
+        if (written.count < buffer.size()) break;
+    }
+    out.remainder = std::string(source.substr(at));
+    return out;
+}
+
+differential::Tokens ranged(std::string_view source)
+{
+    differential::Tokens out;
+    reglex::token_range<TokenTraits> range(source);
+    auto it = range.begin();
+    for (; it != range.end(); ++it)
+    {
+        out.tokens.push_back({it->type,
+                              static_cast<std::size_t>(it->lexeme.data() - source.data()),
+                              std::string(it->lexeme),
+                              it->first_line,
+                              it->num_lines});
+    }
+    out.remainder = std::string(it.remainder());
+    return out;
+}
+
+differential::Tokens arrays(std::string_view source)
+{
+    differential::Tokens out;
+    auto const soa = reglex::lex_soa<TokenTraits>(source);
+    for (std::size_t i = 0; i < soa.size(); ++i)
+    {
+        auto const tok = soa[i];
+        out.tokens.push_back({tok.type, soa.offsets[i], std::string(tok.lexeme), tok.first_line, tok.num_lines});
+    }
+    out.remainder = std::string(soa.remainder);
+    return out;
+}
+} // namespace
+
+int main()
+{
+    using namespace differential;
+    for (std::size_t i = 0; i < sources().size(); ++i)
+    {
+        auto const& source = sources()[i];
+        expect_same(expected()[i], seen(reglex::lex<CompactTraits>(source.text)), source.name + " compact lex");
+        expect_same(expected()[i], buffered<TokenTraits>(source.text), source.name + " lex into a buffer");
+        expect_same(expected()[i], buffered<CompactTraits>(source.text), source.name + " compact lex into a buffer");
+        expect_same(expected()[i], ranged(source.text), source.name + " token_range");
+        expect_same(expected()[i], arrays(source.text), source.name + " lex_soa");
+    }
+    return status();
+}
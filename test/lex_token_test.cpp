@@ -0,0 +1,15 @@
+// lex_token runs in constant expressions, so a grammar's tokens can be checked at compile time.
+// Nothing is left to do at run time.
+
+#include "src/reglex/lox.hpp"
+
+static_assert(reglex::lex_token<TokenTraits>("  var").token.type == TokenType::VAR);
+static_assert(reglex::lex_token<TokenTraits>("  var").status == reglex::Status::UnfilteredMatch);
+// A string across lines after skipped newlines, counting from the given line
+static_assert(reglex::lex_token<TokenTraits>("\n  \"a\nb\" x", 1).token.type == TokenType::STRING);
+static_assert(reglex::lex_token<TokenTraits>("\n  \"a\nb\" x", 1).token.first_line == 2);
+static_assert(reglex::lex_token<TokenTraits>("\n  \"a\nb\" x", 1).token.num_lines == 1);
+static_assert(reglex::lex_token<TokenTraits>("/* c */").status == reglex::Status::FilteredMatch);
+static_assert(reglex::lex_token<TokenTraits>("  \n ").status == reglex::Status::NoMatch);
+
+int main() {}
@@ -0,0 +1,50 @@
+// parallel_lex against lex in both token layouts, with enough threads that the chunks come down to
+// the smallest splits, so comments and strings cross them
+
+#include <reglex/parallel.hpp>
+
+#include "test/differential.hpp"
+
+namespace
+{
+struct CompactTraits : TokenTraits
+{
+    using token_t = reglex::CompactToken<TokenType>;
+};
+
+template <typename Traits>
+void check(std::string const& name, std::string const& text, differential::Tokens const& expected)
+{
+    for (std::size_t threads : {2, 5, 16})
+    {
+        differential::expect_same(expected,
+                                  differential::seen(reglex::parallel_lex<Traits>(text, threads)),
+                                  name + " parallel_lex on " + std::to_string(threads) + " threads");
+    }
+}
+} // namespace
+
+int main()
+{
+    using namespace differential;
+    for (std::size_t i = 0; i < sources().size(); ++i)
+    {
+        auto const& source = sources()[i];
+        check<TokenTraits>(source.name, source.text, expected()[i]);
+        check<CompactTraits>(source.name + " compact", source.text, expected()[i]);
+    }
+    // A string from the first chunk runs over the rest, leaving only trailing whitespace to re-lex
+    std::string spanning;
+    while (spanning.size() < (200 << 10))
+    {
+        spanning += "x = 1;\n";
+    }
+    spanning += '"';
+    while (spanning.size() < (600 << 10))
+    {
+        spanning += "abc\n";
+    }
+    spanning += "\"\n\n";
+    check<TokenTraits>("spanning string", spanning, seen(reglex::lex<TokenTraits>(spanning)));
+    return status();
+}
@@ -0,0 +1,56 @@
+// Token files saved from either layout and loaded into either, against lex, and rejected for the
+// wrong source or another grammar
+
+#include <cstdio>
+
+#include <reglex/dfa.hpp>
+#include <reglex/serialize.hpp>
+
+#include "test/differential.hpp"
+
+namespace
+{
+struct CompactTraits : TokenTraits
+{
+    using token_t = reglex::CompactToken<TokenType>;
+};
+
+// Another engine is another grammar, whose fingerprint differs
+struct DfaTraits : TokenTraits
+{
+    using engine_t = reglex::dfa_engine;
+};
+
+template <typename Traits>
+void check(differential::Source const& source, differential::Tokens const& expected, std::string const& layout)
+{
+    using namespace differential;
+    auto const what = source.name + " saved from " + layout;
+    auto const path = temp_dir() + "/serialize_test.tok";
+    if (!reglex::save_tokens<Traits>(reglex::lex<Traits>(source.text), path)) return fail(what + ": save_tokens");
+    reglex::TokenFile<TokenTraits> const file(path);
+    if (!file.is_valid()) fail(what + ": TokenFile rejected its own grammar");
+    else
+    {
+        expect_same(expected, seen(file.load(source.text)), what + " load");
+        expect_same(expected, seen(file.load<reglex::CompactToken<TokenType>>(source.text)), what + " compact load");
+        if (!file.load(std::string_view(source.text).substr(1)).tokens.empty())
+        {
+            fail(what + ": loaded against the wrong source");
+        }
+    }
+    if (reglex::TokenFile<DfaTraits>(path).is_valid()) fail(what + ": accepted another grammar");
+    std::remove(path.c_str());
+}
+} // namespace
+
+int main()
+{
+    using namespace differential;
+    for (std::size_t i = 0; i < sources().size(); ++i)
+    {
+        check<TokenTraits>(sources()[i], expected()[i], "full tokens");
+        check<CompactTraits>(sources()[i], expected()[i], "compact tokens");
+    }
+    return status();
+}
@@ -0,0 +1,43 @@
+// StreamLexer against lex with the sources fed in random chunks, from single bytes up to pages, so
+// tokens and trivia are split at every kind of place
+
+#include <reglex/stream.hpp>
+
+#include "test/differential.hpp"
+
+int main()
+{
+    using namespace differential;
+    for (std::size_t i = 0; i < sources().size(); ++i)
+    {
+        auto const& source = sources()[i];
+        // Lexemes point into the chunk or the carried buffer, so there is no offset to compare
+        auto expected_tokens = expected()[i];
+        for (auto& tok : expected_tokens.tokens)
+        {
+            tok.offset = 0;
+        }
+        for (std::size_t max_chunk : {1, 17, 4096})
+        {
+            corpus::Random random(max_chunk);
+            reglex::StreamLexer<TokenTraits> stream;
+            Tokens actual;
+            auto const emit = [&](auto const& tok) {
+                actual.tokens.push_back({tok.type, 0, std::string(tok.lexeme), tok.first_line, tok.num_lines});
+            };
+            std::size_t size = 0;
+            for (std::size_t at = 0; at < source.text.size(); at += size)
+            {
+                size = max_chunk == 1 ? 1 : 1 + random.below(max_chunk);
+                stream.feed(std::string_view(source.text).substr(at, size), emit);
+            }
+            actual.remainder = std::string(stream.finish(emit));
+            expect_same(expected_tokens, actual, source.name + " stream chunks up to " + std::to_string(max_chunk));
+            if (stream.offset() + actual.remainder.size() != source.text.size())
+            {
+                fail(source.name + " stream offset after chunks up to " + std::to_string(max_chunk));
+            }
+        }
+    }
+    return status();
+}
@@ -0,0 +1,389 @@
+#pragma once
+#if !defined(REGLEX_CORPUS_H)
+#define REGLEX_CORPUS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+namespace corpus
+{
+/// Shape of a generated corpus. Weights are relative to the others in their group, rates are the
+/// chance out of 1000 that a feature appears at each opportunity.
+struct Options
+{
+    std::uint64_t seed = 1;
+    // Output is cut at the first statement boundary at or past this many bytes
+    std::size_t size = std::size_t{1} << 20;
+
+    // Mix of the operands expressions are built from
+    unsigned identifiers = 8;
+    unsigned numbers = 4;
+    unsigned strings = 2;
+    unsigned literals = 1;
+    // Operators between operands, against a new operand being added
+    unsigned operators = 4;
+
+    // Before each statement, a line or block comment
+    unsigned comments = 100;
+    // For each string, a long one of up to long_string_length bytes
+    unsigned long_strings = 0;
+    std::size_t long_string_length = 4096;
+    // Before each statement, something that looks like a comment opener but isn't one, such as
+    // "/* This /*" in a string, a line comment or a block comment
+    unsigned lookalikes = 0;
+
+    // For each statement, a nested block, capped at max_depth
+    unsigned blocks = 100;
+    std::size_t max_depth = 4;
+    // For each block, a run of blocks straight down to max_depth
+    unsigned deep_blocks = 0;
+};
+
+/// Options for ordinary looking code
+inline Options realistic(std::uint64_t seed, std::size_t size)
+{
+    Options options;
+    options.seed = seed;
+    options.size = size;
+    return options;
+}
+
+/// Options leaning on what is hardest to lex: long strings, comment lookalikes and deep nesting
+inline Options adversarial(std::uint64_t seed, std::size_t size)
+{
+    Options options;
+    options.seed = seed;
+    options.size = size;
+    options.comments = 300;
+    options.long_strings = 50;
+    options.lookalikes = 300;
+    options.max_depth = 64;
+    options.deep_blocks = 50;
+    return options;
+}
+
+/// Options for code with a comment before every statement
+inline Options comment_heavy(std::uint64_t seed, std::size_t size)
+{
+    auto options = realistic(seed, size);
+    options.comments = 1000;
+    return options;
+}
+
+/// Options for code whose operands are almost all strings
+inline Options string_heavy(std::uint64_t seed, std::size_t size)
+{
+    auto options = realistic(seed, size);
+    options.identifiers = 1;
+    options.numbers = 0;
+    options.strings = 16;
+    options.literals = 0;
+    options.comments = 0;
+    return options;
+}
+
+/// Options for code whose operands are all identifiers
+inline Options identifier_heavy(std::uint64_t seed, std::size_t size)
+{
+    auto options = realistic(seed, size);
+    options.identifiers = 1;
+    options.numbers = 0;
+    options.strings = 0;
+    options.literals = 0;
+    options.comments = 0;
+    return options;
+}
+
+/// Options for code which is mostly operators and braces, long expressions in nested blocks
+inline Options punctuation_heavy(std::uint64_t seed, std::size_t size)
+{
+    auto options = identifier_heavy(seed, size);
+    options.operators = 32;
+    options.blocks = 500;
+    return options;
+}
+
+/// splitmix64, written out so the output is the same on every standard library
+class Random
+{
+public:
+    explicit Random(std::uint64_t seed) : state_(seed) {}
+
+    std::uint64_t next() noexcept
+    {
+        auto z = (state_ += 0x9E3779B97F4A7C15u);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9u;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBu;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform enough in [0, n) for n far below 2^64
+    std::size_t below(std::size_t n) noexcept { return n ? static_cast<std::size_t>(next() % n) : 0; }
+
+    bool chance(unsigned per_mille) noexcept { return below(1000) < per_mille; }
+
+private:
+    std::uint64_t state_;
+};
+
+namespace detail
+{
+static constexpr std::string_view words[] = {
+    "alpha", "beta", "gamma_1", "delta", "x", "y", "counter", "value", "i", "total", "name", "_tmp", "nodeList",
+    "iffy", "classy", "fortune", "orange", "printer", "whiled", "variable"};
+static constexpr std::string_view binary_ops[] = {
+    " + ", " - ", " * ", " / ", " == ", " != ", " < ", " <= ", " > ", " >= ", " and ", " or "};
+static constexpr std::string_view literal_words[] = {"true", "false", "nil", "this"};
+static constexpr std::string_view prose[] = {
+    "the", "value", "of", "this", "is", "not", "a", "comment", "*", "/", "**", "var", "print", "3.0", "nil", "\\n"};
+// Text that opens, or seems to open, a comment without being one where it appears, or that a
+// lexer treating comments as nesting would get wrong
+static constexpr std::string_view lookalikes[] = {
+    "/* This /*\nis a multi-line \"comment\" 3.0 nil true\n****** */\n",
+    "/* /* /* */\n",
+    "/*/ still inside */\n",
+    "/**/\n",
+    "/***/\n",
+    "// /* line comment, not a block\n",
+    "print \"/* in a string\";\n",
+    "print \"*/ not closing anything\";\n",
+    "print \"// nor a comment\";\n",
+    "print a / b /* divide */ / c;\n",
+    "print a /b/ c;\n",
+    "print a * /* star */ b */ c;\n"};
+
+class generator
+{
+public:
+    explicit generator(Options const& options) : options_(options), random_(options.seed) {}
+
+    std::string run()
+    {
+        out_.reserve(options_.size + options_.long_string_length + 256);
+        while (out_.size() < options_.size)
+        {
+            statement(0);
+        }
+        return std::move(out_);
+    }
+
+private:
+    void indent(std::size_t depth) { out_.append(depth * 2, ' '); }
+
+    std::string_view pick_word() { return words[random_.below(std::size(words))]; }
+
+    void comment(std::size_t depth)
+    {
+        indent(depth);
+        if (random_.below(2))
+        {
+            out_ += "// ";
+            prose_words(1 + random_.below(10));
+            out_ += '\n';
+            return;
+        }
+        out_ += "/* ";
+        for (std::size_t n = 1 + random_.below(4); n; --n)
+        {
+            prose_words(1 + random_.below(8));
+            out_ += '\n';
+            indent(depth);
+        }
+        out_ += "*/\n";
+    }
+
+    // Words which may appear in a comment. They are space separated, so never close one.
+    void prose_words(std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            if (i) out_ += ' ';
+            out_ += prose[random_.below(std::size(prose))];
+        }
+    }
+
+    void string_literal()
+    {
+        out_ += '"';
+        if (random_.chance(options_.long_strings))
+        {
+            // Long strings span lines, as Lox strings may
+            auto const length = 1 + random_.below(options_.long_string_length);
+            auto const end = out_.size() + length;
+            while (out_.size() < end)
+            {
+                out_ += pick_word();
+                out_ += random_.below(16) ? ' ' : '\n';
+            }
+        }
+        else
+        {
+            for (std::size_t n = random_.below(6); n; --n)
+            {
+                out_ += pick_word();
+                out_ += ' ';
+            }
+        }
+        out_ += '"';
+    }
+
+    void number()
+    {
+        out_ += std::to_string(random_.below(100000));
+        if (random_.below(3) == 0)
+        {
+            out_ += '.';
+            out_ += std::to_string(random_.below(1000));
+        }
+    }
+
+    void operand(std::size_t nesting)
+    {
+        auto const total = options_.identifiers + options_.numbers + options_.strings + options_.literals;
+        auto pick = random_.below(total ? total : 1);
+        if (nesting < 3 && random_.below(8) == 0)
+        {
+            out_ += random_.below(2) ? "(" : "-(";
+            expression(nesting + 1);
+            out_ += ')';
+            return;
+        }
+        if (pick < options_.identifiers)
+        {
+            out_ += pick_word();
+            if (random_.below(6) == 0)
+            {
+                out_ += '.';
+                out_ += pick_word();
+            }
+            else if (nesting < 3 && random_.below(6) == 0)
+            {
+                out_ += '(';
+                expression(nesting + 1);
+                out_ += ')';
+            }
+            return;
+        }
+        pick -= options_.identifiers;
+        if (pick < options_.numbers) return number();
+        pick -= options_.numbers;
+        if (pick < options_.strings) return string_literal();
+        out_ += literal_words[random_.below(std::size(literal_words))];
+    }
+
+    void expression(std::size_t nesting = 0)
+    {
+        operand(nesting);
+        while (random_.below(options_.operators + 4) < options_.operators)
+        {
+            out_ += binary_ops[random_.below(std::size(binary_ops))];
+            operand(nesting);
+        }
+    }
+
+    void block(std::size_t depth)
+    {
+        out_ += "{\n";
+        if (depth < options_.max_depth && random_.chance(options_.deep_blocks))
+        {
+            // Straight down to the depth limit, then back out
+            auto const start = depth;
+            for (; depth < options_.max_depth; ++depth)
+            {
+                indent(depth + 1);
+                out_ += "{\n";
+            }
+            statement(depth + 1);
+            while (depth-- > start)
+            {
+                indent(depth + 1);
+                out_ += "}\n";
+            }
+            depth = start;
+        }
+        for (std::size_t n = 1 + random_.below(4); n; --n)
+        {
+            statement(depth + 1);
+        }
+        indent(depth);
+        out_ += "}\n";
+    }
+
+    void statement(std::size_t depth)
+    {
+        if (random_.chance(options_.comments)) comment(depth);
+        if (random_.chance(options_.lookalikes))
+        {
+            indent(depth);
+            out_ += lookalikes[random_.below(std::size(lookalikes))];
+        }
+        indent(depth);
+        if (depth < options_.max_depth && random_.chance(options_.blocks))
+        {
+            switch (random_.below(5))
+            {
+            case 0:
+                out_ += "if (";
+                expression();
+                out_ += ") ";
+                break;
+            case 1:
+                out_ += "while (";
+                expression();
+                out_ += ") ";
+                break;
+            case 2:
+                out_ += "for (var i = 0; i < ";
+                number();
+                out_ += "; i = i + 1) ";
+                break;
+            case 3:
+                out_ += "fun ";
+                out_ += pick_word();
+                out_ += "(a, b) ";
+                break;
+            default:
+                break;
+            }
+            block(depth);
+            return;
+        }
+        switch (random_.below(4))
+        {
+        case 0:
+            out_ += "var ";
+            out_ += pick_word();
+            out_ += " = ";
+            break;
+        case 1:
+            out_ += pick_word();
+            out_ += " = ";
+            break;
+        case 2:
+            out_ += "print ";
+            break;
+        default:
+            out_ += "return ";
+            break;
+        }
+        expression();
+        out_ += ";\n";
+    }
+
+    Options const& options_;
+    Random random_;
+    std::string out_;
+};
+} // namespace detail
+
+/// Lox source of at least options.size bytes, the same for the same options on every platform
+inline std::string generate(Options const& options)
+{
+    return detail::generator(options).run();
+}
+} // namespace corpus
+
+#endif // REGLEX_CORPUS_H
@@ -0,0 +1,142 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "corpus.hpp"
+
+namespace
+{
+void usage()
+{
+    std::cerr << "usage: lox_corpus [options]\n"
+                 "  --output PATH           write to PATH rather than stdout\n"
+                 "  --seed N                seed, the same seed and options give the same output\n"
+                 "  --size N[K|M|G]         target size in bytes\n"
+                 "  --preset NAME           realistic, adversarial, comments, strings, identifiers or\n"
+                 "                          punctuation, before any other options\n"
+                 "  --identifiers W         weight of identifier operands\n"
+                 "  --numbers W             weight of number operands\n"
+                 "  --strings W             weight of string operands\n"
+                 "  --literals W            weight of true, false, nil and this operands\n"
+                 "  --operators W           weight of continuing an expression with an operator\n"
+                 "  --comments R            comments per 1000 statements\n"
+                 "  --long-strings R        long strings per 1000 strings\n"
+                 "  --long-string-length N  longest long string in bytes\n"
+                 "  --lookalikes R          comment lookalikes per 1000 statements\n"
+                 "  --blocks R              nested blocks per 1000 statements\n"
+                 "  --max-depth N           deepest block nesting\n"
+                 "  --deep-blocks R         runs to the depth limit per 1000 blocks\n";
+}
+
+// Unsigned number with an optional binary K, M or G suffix
+bool parse_size(char const* text, std::size_t& out)
+{
+    char* end = nullptr;
+    auto value = std::strtoull(text, &end, 10);
+    if (end == text) return false;
+    switch (*end)
+    {
+    case 'G':
+        value <<= 10;
+        [[fallthrough]];
+    case 'M':
+        value <<= 10;
+        [[fallthrough]];
+    case 'K':
+        value <<= 10;
+        ++end;
+        break;
+    default:
+        break;
+    }
+    out = static_cast<std::size_t>(value);
+    return *end == '\0';
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    corpus::Options options;
+    char const* output = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view const flag = argv[i];
+        if (flag == "--help")
+        {
+            usage();
+            return 0;
+        }
+        if (i + 1 == argc)
+        {
+            std::cerr << "missing value for " << flag << "\n";
+            return 1;
+        }
+        char const* const value = argv[++i];
+        std::size_t n = 0;
+        if (flag == "--output")
+        {
+            output = value;
+            continue;
+        }
+        if (flag == "--preset")
+        {
+            if (std::strcmp(value, "realistic") == 0) options = corpus::realistic(options.seed, options.size);
+            else if (std::strcmp(value, "adversarial") == 0) options = corpus::adversarial(options.seed, options.size);
+            else if (std::strcmp(value, "comments") == 0) options = corpus::comment_heavy(options.seed, options.size);
+            else if (std::strcmp(value, "strings") == 0) options = corpus::string_heavy(options.seed, options.size);
+            else if (std::strcmp(value, "identifiers") == 0) options = corpus::identifier_heavy(options.seed, options.size);
+            else if (std::strcmp(value, "punctuation") == 0) options = corpus::punctuation_heavy(options.seed, options.size);
+            else
+            {
+                std::cerr << "unknown preset " << value << "\n";
+                return 1;
+            }
+            continue;
+        }
+        if (!parse_size(value, n))
+        {
+            std::cerr << "bad value " << value << " for " << flag << "\n";
+            return 1;
+        }
+        auto const rate = static_cast<unsigned>(n);
+        if (flag == "--seed") options.seed = n;
+        else if (flag == "--size") options.size = n;
+        else if (flag == "--identifiers") options.identifiers = rate;
+        else if (flag == "--numbers") options.numbers = rate;
+        else if (flag == "--strings") options.strings = rate;
+        else if (flag == "--literals") options.literals = rate;
+        else if (flag == "--operators") options.operators = rate;
+        else if (flag == "--comments") options.comments = rate;
+        else if (flag == "--long-strings") options.long_strings = rate;
+        else if (flag == "--long-string-length") options.long_string_length = n;
+        else if (flag == "--lookalikes") options.lookalikes = rate;
+        else if (flag == "--blocks") options.blocks = rate;
+        else if (flag == "--max-depth") options.max_depth = n;
+        else if (flag == "--deep-blocks") options.deep_blocks = rate;
+        else
+        {
+            std::cerr << "unknown option " << flag << "\n";
+            usage();
+            return 1;
+        }
+    }
+
+    auto const source = corpus::generate(options);
+    auto* const file = output ? std::fopen(output, "wb") : stdout;
+    if (!file)
+    {
+        std::cerr << "failed to open " << output << "\n";
+        return 1;
+    }
+    auto const written = std::fwrite(source.data(), 1, source.size(), file);
+    auto const closed = output ? std::fclose(file) : std::fflush(file);
+    if (written != source.size() || closed != 0)
+    {
+        std::cerr << "failed to write " << (output ? output : "stdout") << "\n";
+        return 1;
+    }
+    return 0;
+}